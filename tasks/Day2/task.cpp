@@ -1,17 +1,23 @@
 #include <catch2/catch_all.hpp>
 
+#include <array>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <iterator>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 namespace
 {
 
 enum Figures
 {
+  Invalid = 0,
   Rock = 1,
   Paper = 2,
   Scissors = 3
@@ -20,7 +26,7 @@ enum Figures
 class HandyGame
 {
   public:
-    int play(Figures myFigure, Figures opponentFigure)
+    constexpr int play(Figures myFigure, Figures opponentFigure) const
     {
       constexpr int winScore = 6;
       constexpr int drawScore = 3;
@@ -39,7 +45,7 @@ class HandyGame
       return score;
     };
 
-    static Figures GetWinningFigure(Figures figure)
+    static constexpr Figures GetWinningFigure(Figures figure)
     {
       if (figure == Figures::Rock)
       {
@@ -55,7 +61,7 @@ class HandyGame
       }
     }
 
-    static Figures GetLoosingFigure(Figures figure)
+    static constexpr Figures GetLoosingFigure(Figures figure)
     {
       if (figure == Figures::Rock)
       {
@@ -72,71 +78,553 @@ class HandyGame
     }    
 };
 
-std::map<char, Figures> encodedFigures
+using FiguresEncoding = std::array<Figures, 256>;
+
+constexpr FiguresEncoding MakeFiguresEncoding()
 {
-  {'A', Figures::Rock},
-  {'X', Figures::Rock},
-  {'B', Figures::Paper},
-  {'Y', Figures::Paper},
-  {'C', Figures::Scissors},
-  {'Z', Figures::Scissors},
-};
+  FiguresEncoding encoding{};
+  encoding['A'] = Figures::Rock;
+  encoding['X'] = Figures::Rock;
+  encoding['B'] = Figures::Paper;
+  encoding['Y'] = Figures::Paper;
+  encoding['C'] = Figures::Scissors;
+  encoding['Z'] = Figures::Scissors;
+  return encoding;
+}
 
-Figures ConvertCharToFigure(char c)
+// Every byte outside the encoding decodes to Figures::Invalid.
+constexpr FiguresEncoding encodedFigures = MakeFiguresEncoding();
+
+constexpr Figures ConvertCharToFigure(char c)
 {
-  return encodedFigures[c];
+  return encodedFigures[static_cast<unsigned char>(c)];
 }
 
-std::pair<Figures, Figures> ConvertStrategyToFigures(char first, char second)
+constexpr Figures ChooseFigureForStrategy(Figures oponentFigure, char second)
 {
-  Figures oponentFigure = encodedFigures[first];
-  
-  Figures myFigure{};
   if (second == 'X')
   {
-    myFigure = HandyGame::GetLoosingFigure(oponentFigure);
+    return HandyGame::GetLoosingFigure(oponentFigure);
   }
   else if (second == 'Y')
   {
-    myFigure = oponentFigure;
+    return oponentFigure;
   }
   else
   {
-    myFigure = HandyGame::GetWinningFigure(oponentFigure);
+    return HandyGame::GetWinningFigure(oponentFigure);
   }
+}
 
-  return {oponentFigure, myFigure};
+std::pair<Figures, Figures> ConvertStrategyToFigures(char first, char second)
+{
+  Figures oponentFigure = ConvertCharToFigure(first);
+  return {oponentFigure, ChooseFigureForStrategy(oponentFigure, second)};
 }
 
-int PlayGame(std::basic_istream<char>& istream )
+constexpr std::size_t figuresCount = 3;
+
+// Score of a round indexed by decoded [opponent figure][second figure].
+// Row and column Figures::Invalid stay zero, so malformed bytes score nothing.
+using ScoreTable = std::array<std::array<int, figuresCount + 1>, figuresCount + 1>;
+
+// Figure played for 'X', 'Y' and 'Z' respectively.
+using FigureMapping = std::array<Figures, figuresCount>;
+
+constexpr FigureMapping defaultMapping{Figures::Rock, Figures::Paper, Figures::Scissors};
+
+constexpr ScoreTable MakeScoreTable(const FigureMapping& mapping = defaultMapping)
+{
+  ScoreTable table{};
+  for (std::size_t first = 1; first <= figuresCount; ++first)
+  {
+    for (std::size_t second = 1; second <= figuresCount; ++second)
+    {
+      table[first][second] = HandyGame{}.play(mapping[second - 1], static_cast<Figures>(first));
+    }
+  }
+  return table;
+}
+
+constexpr ScoreTable MakeStrategyScoreTable()
+{
+  ScoreTable table{};
+  for (std::size_t first = 1; first <= figuresCount; ++first)
+  {
+    for (std::size_t second = 1; second <= figuresCount; ++second)
+    {
+      const auto oponentFigure = static_cast<Figures>(first);
+      const auto myFigure = ChooseFigureForStrategy(oponentFigure, static_cast<char>('X' + second - 1));
+      table[first][second] = HandyGame{}.play(myFigure, oponentFigure);
+    }
+  }
+  return table;
+}
+
+constexpr ScoreTable scoreTable = MakeScoreTable();
+constexpr ScoreTable strategyScoreTable = MakeStrategyScoreTable();
+
+constexpr int ScoreRound(const ScoreTable& table, char first, char second)
+{
+  return table[ConvertCharToFigure(first)][ConvertCharToFigure(second)];
+}
+
+int ScoreGame(std::basic_istream<char>& istream, const ScoreTable& table)
 {
   int score = 0;
   std::string segment;
-  HandyGame game;
 
   while(std::getline(istream, segment))
   {
-    score += game.play(ConvertCharToFigure(segment[2]), ConvertCharToFigure(segment[0]));
+    // Short lines decode '\0' which maps to Figures::Invalid.
+    score += ScoreRound(table, segment[0], segment.size() > 2 ? segment[2] : '\0');
   }
 
   return score;
 }
 
+int PlayGame(std::basic_istream<char>& istream )
+{
+  return ScoreGame(istream, scoreTable);
+}
+
 int PlayGameWithStrategy(std::basic_istream<char>& istream )
 {
-  int score = 0;
-  std::string segment;
-  HandyGame game;
+  return ScoreGame(istream, strategyScoreTable);
+}
 
-  while(std::getline(istream, segment))
+// Number of rounds of each line type, indexed like ScoreTable.
+// Malformed lines land in row or column Figures::Invalid and score zero.
+using RoundsHistogram = std::array<std::array<long long, figuresCount + 1>, figuresCount + 1>;
+
+constexpr std::size_t RoundBin(char first, char second)
+{
+  return static_cast<std::size_t>(ConvertCharToFigure(first)) * (figuresCount + 1) +
+         static_cast<std::size_t>(ConvertCharToFigure(second));
+}
+
+RoundsHistogram BuildRoundsHistogram(std::string_view rounds)
+{
+  constexpr std::size_t lineSize = 4;
+  constexpr std::size_t lanes = 4;
+  constexpr std::size_t binsCount = (figuresCount + 1) * (figuresCount + 1);
+
+  // Separate counters per lane so consecutive increments of the same bin do not serialize.
+  std::array<std::array<long long, binsCount>, lanes> laneBins{};
+  std::size_t pos = 0;
+
+  const auto isRound = [&rounds](std::size_t at)
+  {
+    return rounds[at + 1] == ' ' and rounds[at + 3] == '\n';
+  };
+
+  while (pos + lanes * lineSize <= rounds.size() and
+         isRound(pos) and isRound(pos + lineSize) and isRound(pos + 2 * lineSize) and isRound(pos + 3 * lineSize))
+  {
+    for (std::size_t lane = 0; lane < lanes; ++lane)
+    {
+      const auto at = pos + lane * lineSize;
+      ++laneBins[lane][RoundBin(rounds[at], rounds[at + 2])];
+    }
+    pos += lanes * lineSize;
+  }
+
+  while (pos < rounds.size())
+  {
+    auto lineEnd = rounds.find('\n', pos);
+    if (lineEnd == std::string_view::npos)
+    {
+      lineEnd = rounds.size();
+    }
+
+    const auto line = rounds.substr(pos, lineEnd - pos);
+    pos = lineEnd + 1;
+
+    if (not line.empty())
+    {
+      ++laneBins[0][RoundBin(line[0], line.size() > 2 ? line[2] : '\0')];
+    }
+  }
+
+  RoundsHistogram histogram{};
+  for (std::size_t bin = 0; bin < binsCount; ++bin)
+  {
+    for (const auto& bins : laneBins)
+    {
+      histogram[bin / (figuresCount + 1)][bin % (figuresCount + 1)] += bins[bin];
+    }
+  }
+  return histogram;
+}
+
+// Splits rounds into threadsCount pieces that begin at line starts.
+std::vector<std::string_view> SplitIntoLineChunks(std::string_view rounds, std::size_t threadsCount)
+{
+  threadsCount = std::max<std::size_t>(threadsCount, 1);
+
+  std::vector<std::size_t> chunkBegins{0};
+  for (std::size_t chunk = 1; chunk < threadsCount; ++chunk)
+  {
+    const auto lineEnd = rounds.find('\n', std::max(rounds.size() * chunk / threadsCount, chunkBegins.back()));
+    chunkBegins.push_back(lineEnd == std::string_view::npos ? rounds.size() : lineEnd + 1);
+  }
+  chunkBegins.push_back(rounds.size());
+
+  std::vector<std::string_view> chunks;
+  for (std::size_t chunk = 0; chunk < threadsCount; ++chunk)
   {
-    auto [oponentFigure, myFigure] = ConvertStrategyToFigures(segment[0], segment[2]);
-    score += game.play(myFigure, oponentFigure);
+    chunks.push_back(rounds.substr(chunkBegins[chunk], chunkBegins[chunk + 1] - chunkBegins[chunk]));
   }
+  return chunks;
+}
+
+RoundsHistogram BuildRoundsHistogram(std::string_view rounds, std::size_t threadsCount)
+{
+  const auto chunks = SplitIntoLineChunks(rounds, threadsCount);
 
+  std::vector<RoundsHistogram> histograms(chunks.size());
+  std::vector<std::thread> workers;
+  for (std::size_t chunk = 0; chunk < chunks.size(); ++chunk)
+  {
+    workers.emplace_back([&, chunk]()
+    {
+      histograms[chunk] = BuildRoundsHistogram(chunks[chunk]);
+    });
+  }
+
+  RoundsHistogram histogram{};
+  for (std::size_t chunk = 0; chunk < chunks.size(); ++chunk)
+  {
+    workers[chunk].join();
+    for (std::size_t first = 0; first <= figuresCount; ++first)
+    {
+      for (std::size_t second = 0; second <= figuresCount; ++second)
+      {
+        histogram[first][second] += histograms[chunk][first][second];
+      }
+    }
+  }
+  return histogram;
+}
+
+RoundsHistogram BuildRoundsHistogram(std::basic_istream<char>& istream)
+{
+  const std::string rounds{std::istreambuf_iterator<char>{istream}, std::istreambuf_iterator<char>{}};
+  return BuildRoundsHistogram(std::string_view{rounds});
+}
+
+constexpr long long ScoreHistogram(const RoundsHistogram& histogram, const ScoreTable& table)
+{
+  long long score = 0;
+  for (std::size_t first = 0; first <= figuresCount; ++first)
+  {
+    for (std::size_t second = 0; second <= figuresCount; ++second)
+    {
+      score += histogram[first][second] * table[first][second];
+    }
+  }
   return score;
 }
 
+constexpr long long CountInvalidRounds(const RoundsHistogram& histogram)
+{
+  long long invalidRounds = 0;
+  for (std::size_t figure = 0; figure <= figuresCount; ++figure)
+  {
+    invalidRounds += histogram[Figures::Invalid][figure] + histogram[figure][Figures::Invalid];
+  }
+  return invalidRounds - histogram[Figures::Invalid][Figures::Invalid];
+}
+
+std::vector<std::pair<FigureMapping, long long>> ScoreAllMappings(const RoundsHistogram& histogram)
+{
+  std::vector<std::pair<FigureMapping, long long>> scores;
+  auto mapping = defaultMapping;
+
+  do
+  {
+    scores.emplace_back(mapping, ScoreHistogram(histogram, MakeScoreTable(mapping)));
+  } while (std::next_permutation(mapping.begin(), mapping.end()));
+
+  return scores;
+}
+
+std::pair<FigureMapping, long long> FindBestMapping(const RoundsHistogram& histogram)
+{
+  const auto scores = ScoreAllMappings(histogram);
+  return *std::max_element(scores.begin(), scores.end(),
+                           [](const auto& lhs, const auto& rhs){ return lhs.second < rhs.second; });
+}
+
+struct GameResult
+{
+  long long score;
+  std::size_t invalidRounds;
+};
+
+GameResult ScoreRounds(std::string_view rounds, const ScoreTable& table)
+{
+  GameResult result{};
+  std::size_t pos = 0;
+
+  while (pos < rounds.size())
+  {
+    auto lineEnd = rounds.find('\n', pos);
+    if (lineEnd == std::string_view::npos)
+    {
+      lineEnd = rounds.size();
+    }
+
+    const auto line = rounds.substr(pos, lineEnd - pos);
+    pos = lineEnd + 1;
+
+    if (line.empty())
+    {
+      continue;
+    }
+
+    const auto first = line.size() > 2 ? ConvertCharToFigure(line[0]) : Figures::Invalid;
+    const auto second = line.size() > 2 ? ConvertCharToFigure(line[2]) : Figures::Invalid;
+    if (first == Figures::Invalid or second == Figures::Invalid)
+    {
+      ++result.invalidRounds;
+      continue;
+    }
+    result.score += table[first][second];
+  }
+
+  return result;
+}
+
+GameResult PlayGameInParallel(std::string_view rounds, const ScoreTable& table, std::size_t threadsCount)
+{
+  const auto chunks = SplitIntoLineChunks(rounds, threadsCount);
+
+  std::vector<GameResult> results(chunks.size());
+  std::vector<std::thread> workers;
+  for (std::size_t chunk = 0; chunk < chunks.size(); ++chunk)
+  {
+    workers.emplace_back([&, chunk]()
+    {
+      results[chunk] = ScoreRounds(chunks[chunk], table);
+    });
+  }
+
+  GameResult result{};
+  for (std::size_t chunk = 0; chunk < chunks.size(); ++chunk)
+  {
+    workers[chunk].join();
+    result.score += results[chunk].score;
+    result.invalidRounds += results[chunk].invalidRounds;
+  }
+  return result;
+}
+
+GameResult PlayGameInParallel(std::basic_istream<char>& istream, const ScoreTable& table,
+                              std::size_t threadsCount = std::thread::hardware_concurrency())
+{
+  const std::string rounds{std::istreambuf_iterator<char>{istream}, std::istreambuf_iterator<char>{}};
+  return PlayGameInParallel(std::string_view{rounds}, table, threadsCount);
+}
+
+// Odd-sized cyclic tournament: each figure beats the figures an odd number of steps before it.
+template <std::size_t N>
+struct CyclicRules
+{
+  static_assert(N % 2 == 1, "every figure must beat exactly half of the others");
+  static_assert(N >= 3, "a cyclic game needs at least three figures");
+
+  static constexpr int winScore = 6;
+  static constexpr int drawScore = 3;
+
+  static constexpr bool Beats(std::size_t winner, std::size_t looser)
+  {
+    return (winner + N - looser) % N % 2 == 1;
+  }
+};
+
+struct RockPaperScissorsRules : CyclicRules<3>
+{
+  static constexpr std::string_view opponentSymbols{"ABC"};
+  static constexpr std::string_view playerSymbols{"XYZ"};
+};
+
+struct RockPaperScissorsLizardSpockRules : CyclicRules<5>
+{
+  // Rock, Paper, Scissors, Spock, Lizard
+  static constexpr std::string_view opponentSymbols{"ABCDE"};
+  static constexpr std::string_view playerSymbols{"XYZUV"};
+};
+
+template <std::size_t N, typename Rules>
+constexpr std::array<std::size_t, 256> MakeCyclicEncoding()
+{
+  std::array<std::size_t, 256> encoding{};
+  for (auto& figure : encoding)
+  {
+    figure = N;
+  }
+  for (std::size_t figure = 0; figure < N; ++figure)
+  {
+    encoding[static_cast<unsigned char>(Rules::opponentSymbols[figure])] = figure;
+    encoding[static_cast<unsigned char>(Rules::playerSymbols[figure])] = figure;
+  }
+  return encoding;
+}
+
+template <std::size_t N, typename Rules>
+constexpr std::array<std::array<bool, N>, N> MakeBeatsTable()
+{
+  std::array<std::array<bool, N>, N> beats{};
+  for (std::size_t winner = 0; winner < N; ++winner)
+  {
+    for (std::size_t looser = 0; looser < N; ++looser)
+    {
+      beats[winner][looser] = Rules::Beats(winner, looser);
+    }
+  }
+  return beats;
+}
+
+// For each figure the nearest figure following it in the cycle that beats it (or loses to it).
+template <std::size_t N, typename Rules>
+constexpr std::array<std::size_t, N> MakeCounterFigures(bool winning)
+{
+  std::array<std::size_t, N> counters{};
+  for (std::size_t figure = 0; figure < N; ++figure)
+  {
+    for (std::size_t step = 1; step < N; ++step)
+    {
+      const auto counter = winning ? (figure + step) % N : (figure + N - step) % N;
+      if (winning ? Rules::Beats(counter, figure) : Rules::Beats(figure, counter))
+      {
+        counters[figure] = counter;
+        break;
+      }
+    }
+  }
+  return counters;
+}
+
+template <std::size_t N, typename Rules>
+constexpr int ScoreCyclicRound(std::size_t myFigure, std::size_t opponentFigure)
+{
+  int score = static_cast<int>(myFigure) + 1;
+  if (Rules::Beats(myFigure, opponentFigure))
+  {
+    score += Rules::winScore;
+  }
+  else if (myFigure == opponentFigure)
+  {
+    score += Rules::drawScore;
+  }
+  return score;
+}
+
+// Indexed by [opponent figure][my figure]; the last row and column hold zeros for invalid bytes.
+template <std::size_t N, typename Rules>
+constexpr std::array<std::array<int, N + 1>, N + 1> MakeCyclicScoreTable()
+{
+  std::array<std::array<int, N + 1>, N + 1> table{};
+  for (std::size_t opponent = 0; opponent < N; ++opponent)
+  {
+    for (std::size_t mine = 0; mine < N; ++mine)
+    {
+      table[opponent][mine] = ScoreCyclicRound<N, Rules>(mine, opponent);
+    }
+  }
+  return table;
+}
+
+// Indexed by [opponent figure][outcome], where the first three player symbols mean lose, draw, win.
+template <std::size_t N, typename Rules>
+constexpr std::array<std::array<int, N + 1>, N + 1> MakeCyclicStrategyScoreTable()
+{
+  constexpr auto winningFigures = MakeCounterFigures<N, Rules>(true);
+  constexpr auto losingFigures = MakeCounterFigures<N, Rules>(false);
+
+  std::array<std::array<int, N + 1>, N + 1> table{};
+  for (std::size_t opponent = 0; opponent < N; ++opponent)
+  {
+    const std::array<std::size_t, 3> outcomes{losingFigures[opponent], opponent, winningFigures[opponent]};
+    for (std::size_t outcome = 0; outcome < outcomes.size() and outcome < N; ++outcome)
+    {
+      table[opponent][outcome] = ScoreCyclicRound<N, Rules>(outcomes[outcome], opponent);
+    }
+  }
+  return table;
+}
+
+template <std::size_t N, typename Rules>
+class CyclicGame
+{
+  static_assert(Rules::opponentSymbols.size() == N and Rules::playerSymbols.size() == N);
+
+  public:
+    using Table = std::array<std::array<int, N + 1>, N + 1>;
+    using Histogram = std::array<std::array<long long, N + 1>, N + 1>;
+
+    static constexpr std::size_t invalidFigure = N;
+    static constexpr auto encoding = MakeCyclicEncoding<N, Rules>();
+    static constexpr auto beats = MakeBeatsTable<N, Rules>();
+    static constexpr auto winningFigures = MakeCounterFigures<N, Rules>(true);
+    static constexpr auto losingFigures = MakeCounterFigures<N, Rules>(false);
+    static constexpr Table scoreTable = MakeCyclicScoreTable<N, Rules>();
+    static constexpr Table strategyScoreTable = MakeCyclicStrategyScoreTable<N, Rules>();
+
+    static constexpr std::size_t Decode(char c)
+    {
+      return encoding[static_cast<unsigned char>(c)];
+    }
+
+    static Histogram BuildHistogram(std::string_view rounds)
+    {
+      Histogram histogram{};
+      std::size_t pos = 0;
+
+      while (pos < rounds.size())
+      {
+        auto lineEnd = rounds.find('\n', pos);
+        if (lineEnd == std::string_view::npos)
+        {
+          lineEnd = rounds.size();
+        }
+        if (lineEnd - pos > 2)
+        {
+          ++histogram[Decode(rounds[pos])][Decode(rounds[pos + 2])];
+        }
+        pos = lineEnd + 1;
+      }
+
+      return histogram;
+    }
+
+    static constexpr long long Score(const Histogram& histogram, const Table& table)
+    {
+      return Score(histogram, table, std::make_index_sequence<(N + 1) * (N + 1)>{});
+    }
+
+    static long long Play(std::string_view rounds)
+    {
+      return Score(BuildHistogram(rounds), scoreTable);
+    }
+
+    static long long PlayWithStrategy(std::string_view rounds)
+    {
+      return Score(BuildHistogram(rounds), strategyScoreTable);
+    }
+
+  private:
+    template <std::size_t... Bins>
+    static constexpr long long Score(const Histogram& histogram, const Table& table, std::index_sequence<Bins...>)
+    {
+      return ((histogram[Bins / (N + 1)][Bins % (N + 1)] * table[Bins / (N + 1)][Bins % (N + 1)]) + ...);
+    }
+};
+
+using RockPaperScissorsGame = CyclicGame<3, RockPaperScissorsRules>;
+using RockPaperScissorsLizardSpockGame = CyclicGame<5, RockPaperScissorsLizardSpockRules>;
+
 }
 
 TEST_CASE("Play game")
@@ -176,6 +664,13 @@ TEST_CASE("Convert input to figures")
     CHECK(Figures::Scissors == ConvertCharToFigure('Z'));
   }
 
+  SECTION("Report invalid chars")
+  {
+    CHECK(Figures::Invalid == ConvertCharToFigure('\r'));
+    CHECK(Figures::Invalid == ConvertCharToFigure(' '));
+    CHECK(Figures::Invalid == ConvertCharToFigure('\xff'));
+  }
+
   SECTION("Convert chars to figures with strategy")
   {
     auto [oponentFigure, myFigure] = ConvertStrategyToFigures('A', 'X');
@@ -192,6 +687,42 @@ TEST_CASE("Convert input to figures")
   }
 }
 
+TEST_CASE("Score tables")
+{
+  SECTION("score table matches played game")
+  {
+    static_assert(ScoreRound(scoreTable, 'A', 'Y') == 8);
+    static_assert(ScoreRound(scoreTable, 'B', 'X') == 1);
+    static_assert(ScoreRound(scoreTable, 'C', 'Z') == 6);
+
+    HandyGame game;
+    for (const char first : {'A', 'B', 'C'})
+    {
+      for (const char second : {'X', 'Y', 'Z'})
+      {
+        CHECK(game.play(ConvertCharToFigure(second), ConvertCharToFigure(first)) == ScoreRound(scoreTable, first, second));
+      }
+    }
+  }
+
+  SECTION("strategy score table matches played game")
+  {
+    static_assert(ScoreRound(strategyScoreTable, 'A', 'Y') == 4);
+    static_assert(ScoreRound(strategyScoreTable, 'B', 'X') == 1);
+    static_assert(ScoreRound(strategyScoreTable, 'C', 'Z') == 7);
+
+    HandyGame game;
+    for (const char first : {'A', 'B', 'C'})
+    {
+      for (const char second : {'X', 'Y', 'Z'})
+      {
+        auto [oponentFigure, myFigure] = ConvertStrategyToFigures(first, second);
+        CHECK(game.play(myFigure, oponentFigure) == ScoreRound(strategyScoreTable, first, second));
+      }
+    }
+  }
+}
+
 TEST_CASE("Play game from test input")
 {
   SECTION("one by one")
@@ -219,6 +750,169 @@ TEST_CASE("Play game from test input")
     test << "C Z";
     CHECK(12 == PlayGameWithStrategy(test));
   }
+
+  SECTION("blank and invalid lines score nothing")
+  {
+    static_assert(ScoreRound(scoreTable, 'D', 'Y') == 0);
+    static_assert(ScoreRound(scoreTable, 'A', '\0') == 0);
+
+    std::stringstream test{"A Y\n\nB X\nD Y\nA\nC Z"};
+    CHECK(15 == PlayGame(test));
+
+    std::stringstream strategyTest{"A Y\n\nB X\nD Y\nA\nC Z"};
+    CHECK(12 == PlayGameWithStrategy(strategyTest));
+  }
+}
+
+TEST_CASE("Rounds histogram")
+{
+  std::stringstream test{};
+  test << "A Y\n";
+  test << "B X\n";
+  test << "C Z\n";
+  test << "A Y\n";
+  test << "A Y\n";
+  test << "C Z";
+  const auto histogram = BuildRoundsHistogram(test);
+
+  SECTION("count rounds of each type")
+  {
+    CHECK(3 == histogram[Figures::Rock][Figures::Paper]);
+    CHECK(1 == histogram[Figures::Paper][Figures::Rock]);
+    CHECK(2 == histogram[Figures::Scissors][Figures::Scissors]);
+    CHECK(0 == histogram[Figures::Rock][Figures::Rock]);
+    CHECK(0 == CountInvalidRounds(histogram));
+  }
+
+  SECTION("score histogram with both interpretations")
+  {
+    CHECK(3 * 8 + 1 + 2 * 6 == ScoreHistogram(histogram, scoreTable));
+    CHECK(3 * 4 + 1 + 2 * 7 == ScoreHistogram(histogram, strategyScoreTable));
+  }
+
+  SECTION("score all figure mappings")
+  {
+    const auto scores = ScoreAllMappings(histogram);
+    CHECK(6 == scores.size());
+    CHECK(defaultMapping == scores.front().first);
+    CHECK(ScoreHistogram(histogram, scoreTable) == scores.front().second);
+
+    const auto [bestMapping, bestScore] = FindBestMapping(histogram);
+    CHECK(std::all_of(scores.begin(), scores.end(), [&](const auto& score){ return score.second <= bestScore; }));
+    CHECK(bestScore == ScoreHistogram(histogram, MakeScoreTable(bestMapping)));
+  }
+
+  SECTION("histogram of irregular lines")
+  {
+    CHECK(histogram == BuildRoundsHistogram(std::string_view{"A Y\nB X\nC Z\nA Y\nA Y\nC Z\n"}));
+    CHECK(histogram == BuildRoundsHistogram(std::string_view{"A Y\r\nB X\r\nC Z\r\nA Y\r\nA Y\r\nC Z\r\n"}));
+  }
+
+  SECTION("blank lines are skipped")
+  {
+    const auto withBlank = BuildRoundsHistogram(std::string_view{"A Y\n\nB X\n"});
+    CHECK(1 == withBlank[Figures::Rock][Figures::Paper]);
+    CHECK(1 == withBlank[Figures::Paper][Figures::Rock]);
+    CHECK(0 == CountInvalidRounds(withBlank));
+  }
+
+  SECTION("out of alphabet lines are counted as invalid")
+  {
+    const auto withInvalid = BuildRoundsHistogram(std::string_view{"A Y\nD Y\nA Y\nB X\nC Z\nA\nB ?"});
+    CHECK(2 == withInvalid[Figures::Rock][Figures::Paper]);
+    CHECK(1 == withInvalid[Figures::Invalid][Figures::Paper]);
+    CHECK(3 == CountInvalidRounds(withInvalid));
+    CHECK(2 * 8 + 1 + 6 == ScoreHistogram(withInvalid, scoreTable));
+  }
+
+  SECTION("same histogram for any threads count")
+  {
+    const std::string_view rounds{"A Y\nB X\nC Z\nA Y\r\nA Y\nC Z\nB\n\nA Q\nB Y"};
+    for (std::size_t threadsCount = 1; threadsCount <= 16; ++threadsCount)
+    {
+      CHECK(BuildRoundsHistogram(rounds) == BuildRoundsHistogram(rounds, threadsCount));
+    }
+  }
+}
+
+TEST_CASE("Play game in parallel")
+{
+  const std::string_view rounds{"A Y\nB X\nC Z\nA Y\r\nA Y\nC Z\nB\n\nA Q\nB Y"};
+
+  SECTION("score rounds and report invalid ones")
+  {
+    const auto result = ScoreRounds(rounds, scoreTable);
+    CHECK(8 + 1 + 6 + 8 + 8 + 6 + 5 == result.score);
+    CHECK(2 == result.invalidRounds);
+  }
+
+  SECTION("same result for any threads count")
+  {
+    for (std::size_t threadsCount = 1; threadsCount <= 16; ++threadsCount)
+    {
+      const auto result = PlayGameInParallel(rounds, strategyScoreTable, threadsCount);
+      CHECK(ScoreRounds(rounds, strategyScoreTable).score == result.score);
+      CHECK(2 == result.invalidRounds);
+    }
+  }
+
+  SECTION("same result as sequential game")
+  {
+    std::fstream my_file;
+    my_file.open("day2_data.txt", std::ios::in);
+    const auto result = PlayGameInParallel(my_file, scoreTable, 4);
+
+    my_file.clear();
+    my_file.seekg(0);
+    CHECK(PlayGame(my_file) == result.score);
+    CHECK(0 == result.invalidRounds);
+  }
+}
+
+TEST_CASE("Cyclic game")
+{
+  SECTION("rock paper scissors matches handy game")
+  {
+    for (const char first : {'A', 'B', 'C'})
+    {
+      for (const char second : {'X', 'Y', 'Z'})
+      {
+        const auto opponent = RockPaperScissorsGame::Decode(first);
+        const auto mine = RockPaperScissorsGame::Decode(second);
+        CHECK(static_cast<std::size_t>(ConvertCharToFigure(first)) - 1 == opponent);
+        CHECK(ScoreRound(scoreTable, first, second) == RockPaperScissorsGame::scoreTable[opponent][mine]);
+        CHECK(ScoreRound(strategyScoreTable, first, second) == RockPaperScissorsGame::strategyScoreTable[opponent][mine]);
+      }
+    }
+  }
+
+  SECTION("beats and counter figures")
+  {
+    static_assert(RockPaperScissorsGame::beats[0][2]);
+    static_assert(not RockPaperScissorsGame::beats[2][0]);
+    static_assert(RockPaperScissorsGame::winningFigures[0] == 1);
+    static_assert(RockPaperScissorsGame::losingFigures[0] == 2);
+
+    using Game = RockPaperScissorsLizardSpockGame;
+    for (std::size_t figure = 0; figure < 5; ++figure)
+    {
+      CHECK(2 == std::count(Game::beats[figure].begin(), Game::beats[figure].end(), true));
+      CHECK(Game::beats[Game::winningFigures[figure]][figure]);
+      CHECK(Game::beats[figure][Game::losingFigures[figure]]);
+    }
+    CHECK(Game::beats[Game::Decode('U')][Game::Decode('C')]);
+    CHECK(Game::beats[Game::Decode('V')][Game::Decode('D')]);
+    CHECK(Game::beats[Game::Decode('X')][Game::Decode('E')]);
+  }
+
+  SECTION("play whole game")
+  {
+    const std::string_view rounds{"A Y\nB X\nC Z\r\nA ?\n"};
+    CHECK(15 == RockPaperScissorsGame::Play(rounds));
+    CHECK(12 == RockPaperScissorsGame::PlayWithStrategy(rounds));
+
+    CHECK((4 + 6) + (5 + 3) + (2 + 6) == RockPaperScissorsLizardSpockGame::Play("C U\nE V\nD Y"));
+  }
 }
 
 TEST_CASE("read day 2 task 1 data")
@@ -1,91 +1,485 @@
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <fstream>
+#include <numeric>
+#include <string_view>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace
 {
-  std::pair<std::string, std::string> SplitToCompartments(std::string items)
+  std::pair<std::string_view, std::string_view> SplitToCompartments(std::string_view items)
   {
     const auto part1 = items.substr(0, items.size()/2);
     const auto part2 = items.substr(items.size()/2, items.size());
     return {part1, part2};
   }
 
-  char GetCommonItem(std::vector<std::string> backpacks)
+  int CalculateItemPriority(char item)
   {
-    if(backpacks.size() < 2)
+    constexpr int firstValueForUpper = 27;
+    constexpr int firstValueForLower = 1;
+
+    if (isupper(item))
     {
-      return {};
+      return static_cast<int>(item) - static_cast<int>('A') + firstValueForUpper;
     }
+    return static_cast<int>(item) - static_cast<int>('a') + firstValueForLower;
+  }
+
+  // Bit n is set when the item of priority n is present.
+  using ItemsMask = std::uint64_t;
 
-    for (const auto& item : backpacks[0])
+  ItemsMask MakeItemsMask(std::string_view items)
+  {
+    ItemsMask mask = 0;
+    for (const auto item : items)
     {
-      const bool isCommon = std::all_of(backpacks.begin()+1, backpacks.end(),
-                                       [&item](const auto& backpack){ return backpack.find(item) != std::string::npos; });
-      if (isCommon)
+      if (isalpha(static_cast<unsigned char>(item)))
       {
-        return item;
+        mask |= ItemsMask{1} << CalculateItemPriority(item);
       }
     }
+    return mask;
+  }
+
+  int CalculateMaskPriority(ItemsMask mask)
+  {
+    return mask == 0 ? 0 : __builtin_ctzll(mask);
+  }
+
+  int CalculateCommonItemPriority(std::initializer_list<std::string_view> backpacks)
+  {
+    if(backpacks.size() < 2)
+    {
+      return {};
+    }
 
-    return {};
+    ItemsMask common = ~ItemsMask{0};
+    for (const auto& backpack : backpacks)
+    {
+      common &= MakeItemsMask(backpack);
+    }
+
+    return CalculateMaskPriority(common);
   }
 
-  int CalculateItemPriority(char item)
+  char ConvertPriorityToItem(int priority)
   {
     constexpr int firstValueForUpper = 27;
-    constexpr int firstValueForLower = 1;
 
-    if (isupper(item))
+    if (priority <= 0)
     {
-      return static_cast<int>(item) - static_cast<int>('A') + firstValueForUpper;
+      return {};
     }
-    return static_cast<int>(item) - static_cast<int>('a') + firstValueForLower;
+    if (priority >= firstValueForUpper)
+    {
+      return static_cast<char>('A' + priority - firstValueForUpper);
+    }
+    return static_cast<char>('a' + priority - 1);
   }
 
-  int CalculatePriorityForBackpack(std::string items)
+  char GetCommonItem(std::initializer_list<std::string_view> backpacks)
   {
-    const auto [part1, part2] = SplitToCompartments(items);
-    const auto item = GetCommonItem({part1, part2});
-    return CalculateItemPriority(item);
+    return ConvertPriorityToItem(CalculateCommonItemPriority(backpacks));
   }
 
-  int CalculatePriorityForBackpacks(std::basic_istream<char>& backpacks)
+  int CalculatePriorityForBackpack(std::string_view items)
   {
-    int priority = 0;
-    std::string items;
+    const auto [part1, part2] = SplitToCompartments(items);
+    return CalculateCommonItemPriority({part1, part2});
+  }
 
-    while(std::getline(backpacks, items))
+  template <typename Function>
+  void ForEachLine(std::string_view text, Function function)
+  {
+    std::size_t pos = 0;
+    while (pos < text.size())
     {
-      priority += CalculatePriorityForBackpack(items);
+      auto lineEnd = text.find('\n', pos);
+      if (lineEnd == std::string_view::npos)
+      {
+        lineEnd = text.size();
+      }
+      function(text.substr(pos, lineEnd - pos));
+      pos = lineEnd + 1;
     }
+  }
 
+  std::string ReadAll(std::basic_istream<char>& istream)
+  {
+    return {std::istreambuf_iterator<char>{istream}, std::istreambuf_iterator<char>{}};
+  }
+
+  int CalculatePriorityForBackpacks(std::string_view backpacks)
+  {
+    int priority = 0;
+    ForEachLine(backpacks, [&priority](std::string_view items)
+    {
+      priority += CalculatePriorityForBackpack(items);
+    });
     return priority;
   }
 
+  int CalculatePriorityForBackpacks(std::basic_istream<char>& backpacks)
+  {
+    return CalculatePriorityForBackpacks(std::string_view{ReadAll(backpacks)});
+  }
+
+  // Streams backpack masks and keeps priority totals both for consecutive disjoint groups of
+  // groupSize backpacks and for every sliding window of groupSize consecutive backpacks.
+  // Windows are the AND of the suffix of the previous block and the prefix of the current one.
+  class GroupPriorityEngine
+  {
+    public:
+      explicit GroupPriorityEngine(std::size_t size)
+       : groupSize(std::max<std::size_t>(size, 1)),
+         blockMasks(this->groupSize),
+         previousBlockSuffixes(this->groupSize)
+      {
+      }
+
+      void Add(std::string_view items)
+      {
+        Add(MakeItemsMask(items));
+      }
+
+      void Add(ItemsMask mask)
+      {
+        blockMasks[offset] = mask;
+        blockPrefix &= mask;
+        ++backpacksCount;
+
+        if (backpacksCount >= groupSize)
+        {
+          const auto window = offset + 1 < groupSize ? previousBlockSuffixes[offset + 1] & blockPrefix : blockPrefix;
+          windowsPriority += CalculateMaskPriority(window);
+        }
+
+        if (offset + 1 < groupSize)
+        {
+          ++offset;
+          return;
+        }
+
+        groupsPriority += CalculateMaskPriority(blockPrefix);
+
+        ItemsMask suffix = ~ItemsMask{0};
+        for (auto i = groupSize; i-- > 0;)
+        {
+          suffix &= blockMasks[i];
+          previousBlockSuffixes[i] = suffix;
+        }
+        blockPrefix = ~ItemsMask{0};
+        offset = 0;
+      }
+
+      int GetGroupsPriority() const
+      {
+        return groupsPriority;
+      }
+
+      int GetWindowsPriority() const
+      {
+        return windowsPriority;
+      }
+
+    private:
+      std::size_t groupSize;
+      std::vector<ItemsMask> blockMasks;
+      std::vector<ItemsMask> previousBlockSuffixes;
+      ItemsMask blockPrefix = ~ItemsMask{0};
+      std::size_t offset = 0;
+      std::size_t backpacksCount = 0;
+      int groupsPriority = 0;
+      int windowsPriority = 0;
+  };
+
+  GroupPriorityEngine CalculateGroupPriorities(std::string_view backpacks, std::size_t groupSize)
+  {
+    GroupPriorityEngine engine{groupSize};
+    ForEachLine(backpacks, [&engine](std::string_view items)
+    {
+      engine.Add(items);
+    });
+    return engine;
+  }
+
+  int CalculateGroupPriorityForBackpacks(std::string_view backpacks)
+  {
+    return CalculateGroupPriorities(backpacks, 3).GetGroupsPriority();
+  }
+
   int CalculateGroupPriorityForBackpacks(std::basic_istream<char>& backpacks)
   {
-    int priority = 0;
-    std::vector<std::string>::size_type iter = 0;
-    std::string items;
-    std::vector<std::string> group{3};
+    return CalculateGroupPriorityForBackpacks(std::string_view{ReadAll(backpacks)});
+  }
 
-    while(std::getline(backpacks, items))
+  template <typename Function>
+  void RunInParallel(std::size_t threadsCount, Function function)
+  {
+    std::vector<std::thread> workers;
+    for (std::size_t worker = 0; worker < threadsCount; ++worker)
     {
-      group[iter] = items;
+      workers.emplace_back(function, worker);
+    }
+    for (auto& worker : workers)
+    {
+      worker.join();
+    }
+  }
+
+  // Offset of the first byte of every line followed by the buffer size, built from per-block
+  // newline counts turned into each block's first line number by a prefix sum.
+  std::vector<std::size_t> BuildLineIndex(std::string_view text, std::size_t threadsCount)
+  {
+    threadsCount = std::max<std::size_t>(threadsCount, 1);
+    const auto blockBegin = [&](std::size_t block){ return text.size() * block / threadsCount; };
+
+    std::vector<std::size_t> blockLines(threadsCount + 1);
+    RunInParallel(threadsCount, [&](std::size_t block)
+    {
+      blockLines[block + 1] = static_cast<std::size_t>(std::count(text.begin() + static_cast<std::ptrdiff_t>(blockBegin(block)),
+                                                                  text.begin() + static_cast<std::ptrdiff_t>(blockBegin(block + 1)), '\n'));
+    });
+    std::partial_sum(blockLines.begin(), blockLines.end(), blockLines.begin());
+
+    const auto newlines = blockLines.back();
+    const auto linesCount = newlines + (text.empty() or text.back() == '\n' ? 0 : 1);
 
-      if (iter < 2)
+    std::vector<std::size_t> index(linesCount + 1);
+    index.back() = text.size();
+    RunInParallel(threadsCount, [&](std::size_t block)
+    {
+      auto line = blockLines[block];
+      for (auto pos = blockBegin(block); pos < blockBegin(block + 1); ++pos)
       {
-        ++iter;
+        if (text[pos] == '\n')
+        {
+          index[++line] = pos + 1;
+        }
       }
-      else
+    });
+
+    return index;
+  }
+
+  struct Priorities
+  {
+    int backpacks;
+    int groups;
+  };
+
+  // Part 1 and part 2 in one pass; every worker starts on a group boundary.
+  Priorities CalculatePrioritiesInParallel(std::string_view backpacks, std::size_t threadsCount, std::size_t groupSize = 3)
+  {
+    threadsCount = std::max<std::size_t>(threadsCount, 1);
+    groupSize = std::max<std::size_t>(groupSize, 1);
+
+    const auto index = BuildLineIndex(backpacks, threadsCount);
+    const auto linesCount = index.size() - 1;
+    const auto groupsCount = linesCount / groupSize;
+
+    std::vector<Priorities> results(threadsCount);
+    RunInParallel(threadsCount, [&](std::size_t worker)
+    {
+      const auto firstLine = groupsCount * worker / threadsCount * groupSize;
+      const auto lastLine = worker + 1 == threadsCount ? linesCount : groupsCount * (worker + 1) / threadsCount * groupSize;
+
+      Priorities priorities{};
+      ItemsMask common = ~ItemsMask{0};
+      for (auto line = firstLine; line < lastLine; ++line)
       {
-        const auto item = GetCommonItem(group);
-        priority += CalculateItemPriority(item);
-        iter = 0;
+        auto items = backpacks.substr(index[line], index[line + 1] - index[line]);
+        if (not items.empty() and items.back() == '\n')
+        {
+          items.remove_suffix(1);
+        }
+
+        // One pass over the bytes serves both tasks: the halves' union is the whole backpack.
+        const auto [part1, part2] = SplitToCompartments(items);
+        const auto mask1 = MakeItemsMask(part1);
+        const auto mask2 = MakeItemsMask(part2);
+        priorities.backpacks += CalculateMaskPriority(mask1 & mask2);
+
+        common &= mask1 | mask2;
+        if ((line + 1) % groupSize == 0)
+        {
+          priorities.groups += CalculateMaskPriority(common);
+          common = ~ItemsMask{0};
+        }
+      }
+      results[worker] = priorities;
+    });
+
+    Priorities priorities{};
+    for (const auto& result : results)
+    {
+      priorities.backpacks += result.backpacks;
+      priorities.groups += result.groups;
+    }
+    return priorities;
+  }
+
+  // Presence of every byte value: bit n % 64 of word n / 64 is set when byte n is present.
+  using ByteSet = std::array<std::uint64_t, 4>;
+  using PriorityTable = std::array<int, 256>;
+
+  constexpr ByteSet fullByteSet{~std::uint64_t{0}, ~std::uint64_t{0}, ~std::uint64_t{0}, ~std::uint64_t{0}};
+
+  constexpr PriorityTable MakeLetterPriorityTable()
+  {
+    PriorityTable table{};
+    for (int letter = 0; letter < 26; ++letter)
+    {
+      table[static_cast<std::size_t>('a' + letter)] = letter + 1;
+      table[static_cast<std::size_t>('A' + letter)] = letter + 27;
+    }
+    return table;
+  }
+
+  constexpr PriorityTable letterPriorityTable = MakeLetterPriorityTable();
+
+  ByteSet MakeByteSetScalar(std::string_view items)
+  {
+    ByteSet set{};
+    for (const auto item : items)
+    {
+      const auto byte = static_cast<unsigned char>(item);
+      set[byte / 64] |= std::uint64_t{1} << (byte % 64);
+    }
+    return set;
+  }
+
+  void IntersectByteSetsScalar(ByteSet& common, const ByteSet& other)
+  {
+    for (std::size_t word = 0; word < common.size(); ++word)
+    {
+      common[word] &= other[word];
+    }
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+  // Byte flags are written without read-modify-write chains and packed into bits with movemask.
+  __attribute__((target("avx2"))) ByteSet MakeByteSetAvx2(std::string_view items)
+  {
+    alignas(32) std::array<std::uint8_t, 256> present{};
+    for (const auto item : items)
+    {
+      present[static_cast<unsigned char>(item)] = 1;
+    }
+
+    const auto zero = _mm256_setzero_si256();
+    ByteSet set{};
+    for (std::size_t word = 0; word < set.size(); ++word)
+    {
+      const auto low = _mm256_load_si256(reinterpret_cast<const __m256i*>(present.data() + word * 64));
+      const auto high = _mm256_load_si256(reinterpret_cast<const __m256i*>(present.data() + word * 64 + 32));
+      const auto lowBits = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, zero)));
+      const auto highBits = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, zero)));
+      set[word] = std::uint64_t{lowBits} | std::uint64_t{highBits} << 32;
+    }
+    return set;
+  }
+
+  __attribute__((target("avx2"))) void IntersectByteSetsAvx2(ByteSet& common, const ByteSet& other)
+  {
+    const auto lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(common.data()));
+    const auto rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(other.data()));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(common.data()), _mm256_and_si256(lhs, rhs));
+  }
+
+  bool HasAvx2()
+  {
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    return hasAvx2;
+  }
+#else
+  bool HasAvx2()
+  {
+    return false;
+  }
+#endif
+
+  ByteSet MakeByteSet(std::string_view items)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    if (HasAvx2())
+    {
+      return MakeByteSetAvx2(items);
+    }
+#endif
+    return MakeByteSetScalar(items);
+  }
+
+  void IntersectByteSets(ByteSet& common, const ByteSet& other)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    if (HasAvx2())
+    {
+      IntersectByteSetsAvx2(common, other);
+      return;
+    }
+#endif
+    IntersectByteSetsScalar(common, other);
+  }
+
+  // Priority of the lowest byte left in the set, 0 for an empty set.
+  int CalculateByteSetPriority(const ByteSet& set, const PriorityTable& table)
+  {
+    for (std::size_t word = 0; word < set.size(); ++word)
+    {
+      if (set[word] != 0)
+      {
+        return table[word * 64 + static_cast<std::size_t>(__builtin_ctzll(set[word]))];
       }
     }
+    return 0;
+  }
+
+  int CalculateInventoryPriority(std::string_view items, const PriorityTable& table)
+  {
+    const auto [part1, part2] = SplitToCompartments(items);
+    auto common = MakeByteSet(part1);
+    IntersectByteSets(common, MakeByteSet(part2));
+    return CalculateByteSetPriority(common, table);
+  }
+
+  int CalculatePriorityForInventories(std::string_view inventories, const PriorityTable& table)
+  {
+    int priority = 0;
+    ForEachLine(inventories, [&](std::string_view items)
+    {
+      priority += CalculateInventoryPriority(items, table);
+    });
+    return priority;
+  }
+
+  int CalculateGroupPriorityForInventories(std::string_view inventories, std::size_t groupSize, const PriorityTable& table)
+  {
+    int priority = 0;
+    std::size_t iter = 0;
+    auto common = fullByteSet;
+
+    ForEachLine(inventories, [&](std::string_view items)
+    {
+      IntersectByteSets(common, MakeByteSet(items));
+
+      if (++iter == groupSize)
+      {
+        priority += CalculateByteSetPriority(common, table);
+        common = fullByteSet;
+        iter = 0;
+      }
+    });
 
     return priority;
   }
@@ -108,6 +502,29 @@ TEST_CASE("find common item")
   CHECK(item == 'p');
 }
 
+TEST_CASE("find common item priority with masks")
+{
+  CHECK((ItemsMask{1} << 16 | ItemsMask{1} << 42) == MakeItemsMask("pPp"));
+  CHECK(18 == CalculateCommonItemPriority({"vJrwpWtwJgWrhcsFMMfFFhFp", "jqHRNqRjqzjGDLGLrsFMfFZSrLrFZsSL", "PmmdzqPrVvPwwTWBwg"}));
+  CHECK(0 == CalculateCommonItemPriority({"abc", "ABC"}));
+  CHECK(0 == CalculateCommonItemPriority({"abc"}));
+}
+
+TEST_CASE("iterate lines of buffer")
+{
+  std::vector<std::string_view> lines;
+  ForEachLine("ab\n\ncd\nef", [&lines](std::string_view line){ lines.push_back(line); });
+  CHECK(std::vector<std::string_view>{"ab", "", "cd", "ef"} == lines);
+}
+
+TEST_CASE("convert priority to item")
+{
+  CHECK('P' == ConvertPriorityToItem(42));
+  CHECK('p' == ConvertPriorityToItem(16));
+  CHECK('a' == ConvertPriorityToItem(1));
+  CHECK('Z' == ConvertPriorityToItem(52));
+}
+
 TEST_CASE("calculate priority for item")
 {
   CHECK(42 == CalculateItemPriority('P'));
@@ -141,6 +558,123 @@ TEST_CASE("calculate priorities for group")
   CHECK(18 == CalculateGroupPriorityForBackpacks(test));
 }
 
+TEST_CASE("calculate priorities for groups of any size")
+{
+  const std::string_view test{"vJrwpWtwJgWrhcsFMMfFFhFp\n"
+                              "jqHRNqRjqzjGDLGLrsFMfFZSrLrFZsSL\n"
+                              "PmmdzqPrVvPwwTWBwg\n"
+                              "wMqvLMZHhHMvwLHjbvcjnnSBnvTQFn\n"
+                              "ttgJtRGJQctTZtZT\n"
+                              "CrZsJsPPZsGzwwsLwLmpwMDw"};
+
+  std::vector<std::string_view> lines;
+  ForEachLine(test, [&lines](std::string_view line){ lines.push_back(line); });
+
+  SECTION("disjoint groups of three")
+  {
+    CHECK(70 == CalculateGroupPriorities(test, 3).GetGroupsPriority());
+  }
+
+  SECTION("groups and windows match brute force")
+  {
+    for (std::size_t groupSize = 1; groupSize <= lines.size() + 1; ++groupSize)
+    {
+      int groupsPriority = 0;
+      int windowsPriority = 0;
+      for (std::size_t first = 0; first + groupSize <= lines.size(); ++first)
+      {
+        ItemsMask common = ~ItemsMask{0};
+        for (std::size_t line = first; line < first + groupSize; ++line)
+        {
+          common &= MakeItemsMask(lines[line]);
+        }
+        windowsPriority += CalculateMaskPriority(common);
+        groupsPriority += first % groupSize == 0 ? CalculateMaskPriority(common) : 0;
+      }
+
+      const auto engine = CalculateGroupPriorities(test, groupSize);
+      CHECK(groupsPriority == engine.GetGroupsPriority());
+      CHECK(windowsPriority == engine.GetWindowsPriority());
+    }
+  }
+}
+
+TEST_CASE("byte set kernels")
+{
+  std::string items;
+  for (int byte = 0; byte < 256; byte += 3)
+  {
+    items += static_cast<char>(byte);
+  }
+  items += "\xff\x80";
+
+  SECTION("build byte set")
+  {
+    const auto set = MakeByteSetScalar(items);
+    CHECK(set == MakeByteSet(items));
+    CHECK(((set[0] >> 3) & 1) == 1);
+    CHECK(((set[0] >> 4) & 1) == 0);
+    CHECK(((set[3] >> 63) & 1) == 1);
+    CHECK(((set[2] >> 0) & 1) == 1);
+  }
+
+  SECTION("intersect byte sets")
+  {
+    auto scalar = MakeByteSetScalar(items);
+    IntersectByteSetsScalar(scalar, MakeByteSetScalar("\x03\x04\x80"));
+    auto dispatched = MakeByteSet(items);
+    IntersectByteSets(dispatched, MakeByteSet("\x03\x04\x80"));
+
+    CHECK(scalar == dispatched);
+    CHECK(ByteSet{std::uint64_t{1} << 3, 0, 1, 0} == scalar);
+  }
+
+  SECTION("priority from pluggable table")
+  {
+    PriorityTable table{};
+    table[0x80] = 1000;
+    CHECK(1000 == CalculateByteSetPriority(ByteSet{0, 0, 1, 0}, table));
+    CHECK(0 == CalculateByteSetPriority(ByteSet{}, table));
+    CHECK(16 == CalculateInventoryPriority("vJrwpWtwJgWrhcsFMMfFFhFp", letterPriorityTable));
+  }
+
+  SECTION("same totals as letter masks")
+  {
+    std::fstream my_file;
+    my_file.open("day3_data.txt", std::ios::in);
+    const auto inventories = ReadAll(my_file);
+
+    CHECK(CalculatePriorityForBackpacks(inventories) == CalculatePriorityForInventories(inventories, letterPriorityTable));
+    CHECK(CalculateGroupPriorityForBackpacks(inventories) == CalculateGroupPriorityForInventories(inventories, 3, letterPriorityTable));
+  }
+}
+
+TEST_CASE("calculate priorities in parallel")
+{
+  SECTION("index lines")
+  {
+    CHECK(std::vector<std::size_t>{0} == BuildLineIndex("", 4));
+    CHECK(std::vector<std::size_t>{0, 3, 4, 6} == BuildLineIndex("ab\n\ncd", 3));
+    CHECK(std::vector<std::size_t>{0, 3, 4, 7} == BuildLineIndex("ab\n\ncd\n", 8));
+  }
+
+  SECTION("same results as sequential solvers for any threads count")
+  {
+    std::fstream my_file;
+    my_file.open("day3_data.txt", std::ios::in);
+    const auto backpacks = ReadAll(my_file);
+    const auto backpacksPriority = CalculatePriorityForBackpacks(backpacks);
+    const auto groupsPriority = CalculateGroupPriorityForBackpacks(backpacks);
+
+    for (std::size_t threadsCount = 1; threadsCount <= 12; ++threadsCount)
+    {
+      const auto priorities = CalculatePrioritiesInParallel(backpacks, threadsCount);
+      CHECK(backpacksPriority == priorities.backpacks);
+      CHECK(groupsPriority == priorities.groups);
+    }
+  }
+}
+
 TEST_CASE("read day 3 task 1 data")
 {
   std::fstream my_file;
@@ -1,7 +1,18 @@
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <fstream>
+#include <numeric>
+#include <string_view>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace
 {
@@ -22,8 +33,7 @@ public:
 
   bool HasCommonSections(const SectionAssignment& other) const
   {
-    return (this->first <= other.first and this->last >= other.first) or
-            (this->first <= other.last and this->last >= other.last);
+    return this->first <= other.last and other.first <= this->last;
   }
 
 private:
@@ -55,28 +65,411 @@ bool IsPartiallyRepeated(const std::string& assignmentPair)
   return firstList.HasCommonSections(secondList);
 }
 
-int CountFullyRepeated(std::basic_istream<char>& assignmentPairsList)
+// Section bounds of every line "a-b,c-d" kept in separate arrays.
+struct AssignmentPairs
 {
-  int repetitions = 0;
-  std::string segment{};
+  std::vector<std::uint32_t> firstBegins;
+  std::vector<std::uint32_t> firstEnds;
+  std::vector<std::uint32_t> secondBegins;
+  std::vector<std::uint32_t> secondEnds;
+
+  std::size_t size() const
+  {
+    return firstBegins.size();
+  }
+};
+
+AssignmentPairs ParseAssignmentPairs(std::string_view assignmentPairsList)
+{
+  constexpr std::size_t boundsPerLine = 4;
+
+  AssignmentPairs pairs;
+  const auto linesCount = static_cast<std::size_t>(std::count(assignmentPairsList.begin(), assignmentPairsList.end(), '\n')) + 1;
+  pairs.firstBegins.reserve(linesCount);
+  pairs.firstEnds.reserve(linesCount);
+  pairs.secondBegins.reserve(linesCount);
+  pairs.secondEnds.reserve(linesCount);
+
+  std::array<std::uint32_t, boundsPerLine> bounds{};
+  std::size_t boundsCount = 0;
+  std::uint32_t value = 0;
+  bool inNumber = false;
 
-  while (std::getline(assignmentPairsList, segment))
+  const auto finishNumber = [&]()
   {
-    repetitions += IsFullyRepeated(segment);
+    if (inNumber and boundsCount < boundsPerLine)
+    {
+      bounds[boundsCount++] = value;
+    }
+    value = 0;
+    inNumber = false;
+  };
+
+  const auto finishLine = [&]()
+  {
+    finishNumber();
+    if (boundsCount == boundsPerLine)
+    {
+      pairs.firstBegins.push_back(bounds[0]);
+      pairs.firstEnds.push_back(bounds[1]);
+      pairs.secondBegins.push_back(bounds[2]);
+      pairs.secondEnds.push_back(bounds[3]);
+    }
+    boundsCount = 0;
+  };
+
+  for (const auto c : assignmentPairsList)
+  {
+    if (c >= '0' and c <= '9')
+    {
+      value = value * 10 + static_cast<std::uint32_t>(c - '0');
+      inNumber = true;
+    }
+    else if (c == '\n')
+    {
+      finishLine();
+    }
+    else
+    {
+      finishNumber();
+    }
   }
-  return repetitions;
+  finishLine();
+
+  return pairs;
 }
 
-int CountPartiallyRepeated(std::basic_istream<char>& assignmentPairsList)
+struct RepetitionCounts
 {
-  int repetitions = 0;
-  std::string segment{};
+  int full;
+  int partial;
+};
 
-  while (std::getline(assignmentPairsList, segment))
+void CountRepetitionsScalar(const AssignmentPairs& pairs, std::size_t begin, RepetitionCounts& counts)
+{
+  for (std::size_t i = begin; i < pairs.size(); ++i)
   {
-    repetitions += IsPartiallyRepeated(segment);
+    const auto a = pairs.firstBegins[i];
+    const auto b = pairs.firstEnds[i];
+    const auto c = pairs.secondBegins[i];
+    const auto d = pairs.secondEnds[i];
+    counts.full += ((a <= c) & (b >= d)) | ((c <= a) & (d >= b));
+    counts.partial += (a <= d) & (c <= b);
   }
-  return repetitions;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Eight pairs per step; unsigned compares are done as signed ones after flipping the sign bit.
+__attribute__((target("avx2,popcnt"))) std::size_t CountRepetitionsAvx2(const AssignmentPairs& pairs, RepetitionCounts& counts)
+{
+  constexpr std::size_t lanes = 8;
+
+  const auto signBit = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+  const int allLanes = static_cast<int>(lanes);
+
+  std::size_t i = 0;
+  for (; i + lanes <= pairs.size(); i += lanes)
+  {
+    const auto a = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs.firstBegins.data() + i)), signBit);
+    const auto b = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs.firstEnds.data() + i)), signBit);
+    const auto c = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs.secondBegins.data() + i)), signBit);
+    const auto d = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairs.secondEnds.data() + i)), signBit);
+
+    const auto firstNotContainsSecond = _mm256_or_si256(_mm256_cmpgt_epi32(a, c), _mm256_cmpgt_epi32(d, b));
+    const auto secondNotContainsFirst = _mm256_or_si256(_mm256_cmpgt_epi32(c, a), _mm256_cmpgt_epi32(b, d));
+    const auto disjoint = _mm256_or_si256(_mm256_cmpgt_epi32(a, d), _mm256_cmpgt_epi32(c, b));
+
+    const auto notFull = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(firstNotContainsSecond, secondNotContainsFirst)));
+    const auto notPartial = _mm256_movemask_ps(_mm256_castsi256_ps(disjoint));
+    counts.full += allLanes - _mm_popcnt_u32(static_cast<unsigned>(notFull));
+    counts.partial += allLanes - _mm_popcnt_u32(static_cast<unsigned>(notPartial));
+  }
+  return i;
+}
+
+bool HasAvx2()
+{
+  static const bool hasAvx2 = __builtin_cpu_supports("avx2") and __builtin_cpu_supports("popcnt");
+  return hasAvx2;
+}
+#endif
+
+RepetitionCounts CountRepetitions(const AssignmentPairs& pairs)
+{
+  RepetitionCounts counts{};
+  std::size_t counted = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  if (HasAvx2())
+  {
+    counted = CountRepetitionsAvx2(pairs, counts);
+  }
+#endif
+  CountRepetitionsScalar(pairs, counted, counts);
+  return counts;
+}
+
+int CountFullyRepeated(const AssignmentPairs& pairs)
+{
+  return CountRepetitions(pairs).full;
+}
+
+int CountPartiallyRepeated(const AssignmentPairs& pairs)
+{
+  return CountRepetitions(pairs).partial;
+}
+
+struct SectionRange
+{
+  std::uint32_t first;
+  std::uint32_t last;
+};
+
+class FenwickTree
+{
+public:
+  explicit FenwickTree(std::size_t size)
+   : counts(size + 1)
+  {
+  }
+
+  void Add(std::size_t position)
+  {
+    for (++position; position < counts.size(); position += position & (~position + 1))
+    {
+      ++counts[position];
+    }
+  }
+
+  // Number of added positions lower than the given one.
+  std::size_t CountBelow(std::size_t position) const
+  {
+    std::size_t count = 0;
+    for (; position > 0; position -= position & (~position + 1))
+    {
+      count += counts[position];
+    }
+    return count;
+  }
+
+private:
+  std::vector<std::size_t> counts;
+};
+
+// Every assignment of the file, both of each line: assignment 2 * line is the first one of the line.
+class AssignmentsIndex
+{
+public:
+  explicit AssignmentsIndex(const AssignmentPairs& pairs)
+  {
+    ranges.reserve(2 * pairs.size());
+    for (std::size_t i = 0; i < pairs.size(); ++i)
+    {
+      ranges.push_back({pairs.firstBegins[i], pairs.firstEnds[i]});
+      ranges.push_back({pairs.secondBegins[i], pairs.secondEnds[i]});
+    }
+
+    order.resize(ranges.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::sort(order.begin(), order.end(), [this](std::size_t lhs, std::size_t rhs)
+    {
+      return ranges[lhs].first != ranges[rhs].first ? ranges[lhs].first < ranges[rhs].first
+                                                    : ranges[lhs].last > ranges[rhs].last;
+    });
+
+    for (const auto& range : ranges)
+    {
+      sortedFirsts.push_back(range.first);
+      sortedLasts.push_back(range.last);
+    }
+    std::sort(sortedFirsts.begin(), sortedFirsts.end());
+    std::sort(sortedLasts.begin(), sortedLasts.end());
+    sortedLasts.erase(std::unique(sortedLasts.begin(), sortedLasts.end()), sortedLasts.end());
+  }
+
+  std::size_t size() const
+  {
+    return ranges.size();
+  }
+
+  // Pairs of assignments sharing at least one section: all pairs minus the disjoint ones.
+  long long CountOverlappingPairs() const
+  {
+    const auto count = static_cast<long long>(ranges.size());
+    long long disjoint = 0;
+    for (const auto& range : ranges)
+    {
+      disjoint += sortedFirsts.end() - std::upper_bound(sortedFirsts.begin(), sortedFirsts.end(), range.last);
+    }
+    return count * (count - 1) / 2 - disjoint;
+  }
+
+  // Pairs in which one assignment contains the other; equal assignments count once.
+  long long CountContainingPairs() const
+  {
+    FenwickTree lasts{sortedLasts.size()};
+    long long containing = 0;
+    std::size_t inserted = 0;
+
+    for (const auto i : order)
+    {
+      const auto position = CompressLast(ranges[i].last);
+      containing += static_cast<long long>(inserted - lasts.CountBelow(position));
+      lasts.Add(position);
+      ++inserted;
+    }
+    return containing;
+  }
+
+  // For every query the number of assignments containing it, answered offline in order of first section.
+  std::vector<std::size_t> CountContaining(const std::vector<SectionRange>& queries) const
+  {
+    std::vector<std::size_t> queriesOrder(queries.size());
+    std::iota(queriesOrder.begin(), queriesOrder.end(), std::size_t{0});
+    std::sort(queriesOrder.begin(), queriesOrder.end(), [&queries](std::size_t lhs, std::size_t rhs)
+    {
+      return queries[lhs].first < queries[rhs].first;
+    });
+
+    FenwickTree lasts{sortedLasts.size()};
+    std::vector<std::size_t> counts(queries.size());
+    std::size_t inserted = 0;
+
+    for (const auto query : queriesOrder)
+    {
+      while (inserted < order.size() and ranges[order[inserted]].first <= queries[query].first)
+      {
+        lasts.Add(CompressLast(ranges[order[inserted]].last));
+        ++inserted;
+      }
+      counts[query] = inserted - lasts.CountBelow(CompressLast(queries[query].last));
+    }
+    return counts;
+  }
+
+  std::vector<std::size_t> FindContaining(const SectionRange& query) const
+  {
+    std::vector<std::size_t> assignments;
+    for (auto i = order.begin(); i != order.end() and ranges[*i].first <= query.first; ++i)
+    {
+      if (ranges[*i].last >= query.last)
+      {
+        assignments.push_back(*i);
+      }
+    }
+    std::sort(assignments.begin(), assignments.end());
+    return assignments;
+  }
+
+private:
+  // Position of the first stored last section not lower than the given one.
+  std::size_t CompressLast(std::uint32_t last) const
+  {
+    return static_cast<std::size_t>(std::lower_bound(sortedLasts.begin(), sortedLasts.end(), last) - sortedLasts.begin());
+  }
+
+  std::vector<SectionRange> ranges;
+  std::vector<std::size_t> order;
+  std::vector<std::uint32_t> sortedFirsts;
+  std::vector<std::uint32_t> sortedLasts;
+};
+
+// Number of assignments covering each section, kept per segment between compressed boundaries.
+class SectionCoverage
+{
+public:
+  explicit SectionCoverage(const AssignmentPairs& pairs)
+  {
+    std::vector<std::pair<std::uint64_t, int>> changes;
+    changes.reserve(4 * pairs.size());
+    for (std::size_t i = 0; i < pairs.size(); ++i)
+    {
+      changes.emplace_back(pairs.firstBegins[i], 1);
+      changes.emplace_back(std::uint64_t{pairs.firstEnds[i]} + 1, -1);
+      changes.emplace_back(pairs.secondBegins[i], 1);
+      changes.emplace_back(std::uint64_t{pairs.secondEnds[i]} + 1, -1);
+    }
+    std::sort(changes.begin(), changes.end());
+
+    long long depth = 0;
+    for (std::size_t i = 0; i < changes.size(); ++i)
+    {
+      depth += changes[i].second;
+      if (i + 1 < changes.size() and changes[i + 1].first == changes[i].first)
+      {
+        continue;
+      }
+
+      boundaries.push_back(changes[i].first);
+      depths.push_back(static_cast<std::size_t>(depth));
+      maxDepth = std::max(maxDepth, depths.back());
+      if (depth > 0 and i + 1 < changes.size())
+      {
+        coveredSections += changes[i + 1].first - changes[i].first;
+      }
+    }
+  }
+
+  std::size_t CountCovering(std::uint32_t section) const
+  {
+    const auto segment = std::upper_bound(boundaries.begin(), boundaries.end(), section);
+    return segment == boundaries.begin() ? 0 : depths[static_cast<std::size_t>(segment - boundaries.begin()) - 1];
+  }
+
+  std::vector<std::size_t> CountCovering(const std::vector<std::uint32_t>& sections, std::size_t threadsCount) const
+  {
+    threadsCount = std::max<std::size_t>(threadsCount, 1);
+    std::vector<std::size_t> counts(sections.size());
+    std::vector<std::thread> workers;
+
+    for (std::size_t worker = 0; worker < threadsCount; ++worker)
+    {
+      workers.emplace_back([&, worker]()
+      {
+        const auto end = sections.size() * (worker + 1) / threadsCount;
+        for (auto i = sections.size() * worker / threadsCount; i < end; ++i)
+        {
+          counts[i] = CountCovering(sections[i]);
+        }
+      });
+    }
+    for (auto& worker : workers)
+    {
+      worker.join();
+    }
+    return counts;
+  }
+
+  std::uint64_t GetCoveredSectionsCount() const
+  {
+    return coveredSections;
+  }
+
+  std::size_t GetMaxDepth() const
+  {
+    return maxDepth;
+  }
+
+private:
+  std::vector<std::uint64_t> boundaries;
+  std::vector<std::size_t> depths;
+  std::uint64_t coveredSections = 0;
+  std::size_t maxDepth = 0;
+};
+
+AssignmentPairs ReadAssignmentPairs(std::basic_istream<char>& assignmentPairsList)
+{
+  const std::string input{std::istreambuf_iterator<char>{assignmentPairsList}, std::istreambuf_iterator<char>{}};
+  return ParseAssignmentPairs(input);
+}
+
+int CountFullyRepeated(std::basic_istream<char>& assignmentPairsList)
+{
+  return CountFullyRepeated(ReadAssignmentPairs(assignmentPairsList));
+}
+
+int CountPartiallyRepeated(std::basic_istream<char>& assignmentPairsList)
+{
+  return CountPartiallyRepeated(ReadAssignmentPairs(assignmentPairsList));
 }
 
 }
@@ -95,6 +488,8 @@ TEST_CASE("check if has common elements")
 {
   CHECK(SectionAssignment("1-3").HasCommonSections(SectionAssignment("2-5")));
   CHECK(SectionAssignment("1-3").HasCommonSections(SectionAssignment("3-5")));
+  CHECK(SectionAssignment("3-4").HasCommonSections(SectionAssignment("1-6")));
+  CHECK(SectionAssignment("4-5").HasCommonSections(SectionAssignment("1-4")));
 
   CHECK_FALSE(SectionAssignment("1-3").HasCommonSections(SectionAssignment("4-5")));
 }
@@ -114,6 +509,165 @@ TEST_CASE("is any repeated")
   CHECK_FALSE(IsFullyRepeated("22-30,20-29"));
 }
 
+TEST_CASE("is any partially repeated")
+{
+  CHECK(IsPartiallyRepeated("5-7,7-9"));
+  CHECK(IsPartiallyRepeated("2-8,3-7"));
+
+  CHECK_FALSE(IsPartiallyRepeated("2-4,6-8"));
+}
+
+TEST_CASE("parse assignment pairs")
+{
+  const auto pairs = ParseAssignmentPairs("2-4,6-8\n22-30,25-27\r\n\n6-6,4-6");
+  CHECK(3 == pairs.size());
+  CHECK(std::vector<std::uint32_t>{2, 22, 6} == pairs.firstBegins);
+  CHECK(std::vector<std::uint32_t>{4, 30, 6} == pairs.firstEnds);
+  CHECK(std::vector<std::uint32_t>{6, 25, 4} == pairs.secondBegins);
+  CHECK(std::vector<std::uint32_t>{8, 27, 6} == pairs.secondEnds);
+}
+
+TEST_CASE("count repetitions with fused kernel")
+{
+  std::string input;
+  for (std::uint32_t first = 1; first <= 4; ++first)
+  {
+    for (std::uint32_t last = first; last <= 4; ++last)
+    {
+      for (std::uint32_t secondFirst = 1; secondFirst <= 4; ++secondFirst)
+      {
+        for (std::uint32_t secondLast = secondFirst; secondLast <= 4; ++secondLast)
+        {
+          input += std::to_string(first) + "-" + std::to_string(last) + "," +
+                   std::to_string(secondFirst) + "-" + std::to_string(secondLast) + "\n";
+        }
+      }
+    }
+  }
+  const auto pairs = ParseAssignmentPairs(input);
+
+  RepetitionCounts scalar{};
+  CountRepetitionsScalar(pairs, 0, scalar);
+  const auto counts = CountRepetitions(pairs);
+
+  int full = 0;
+  int partial = 0;
+  std::stringstream test{input};
+  std::string segment{};
+  while (std::getline(test, segment))
+  {
+    full += IsFullyRepeated(segment);
+    partial += IsPartiallyRepeated(segment);
+  }
+
+  CHECK(full == scalar.full);
+  CHECK(partial == scalar.partial);
+  CHECK(full == counts.full);
+  CHECK(partial == counts.partial);
+}
+
+TEST_CASE("index of all assignments")
+{
+  std::fstream my_file;
+  my_file.open("day4_data.txt", std::ios::in);
+  const auto pairs = ReadAssignmentPairs(my_file);
+  const AssignmentsIndex index{pairs};
+
+  std::vector<SectionRange> ranges;
+  for (std::size_t i = 0; i < pairs.size(); ++i)
+  {
+    ranges.push_back({pairs.firstBegins[i], pairs.firstEnds[i]});
+    ranges.push_back({pairs.secondBegins[i], pairs.secondEnds[i]});
+  }
+  const auto contains = [](const SectionRange& outer, const SectionRange& inner)
+  {
+    return outer.first <= inner.first and inner.last <= outer.last;
+  };
+
+  SECTION("count overlapping and containing pairs")
+  {
+    long long overlapping = 0;
+    long long containing = 0;
+    for (std::size_t i = 0; i < ranges.size(); ++i)
+    {
+      for (std::size_t j = i + 1; j < ranges.size(); ++j)
+      {
+        overlapping += ranges[i].first <= ranges[j].last and ranges[j].first <= ranges[i].last;
+        containing += contains(ranges[i], ranges[j]) or contains(ranges[j], ranges[i]);
+      }
+    }
+
+    CHECK(2 * pairs.size() == index.size());
+    CHECK(overlapping == index.CountOverlappingPairs());
+    CHECK(containing == index.CountContainingPairs());
+  }
+
+  SECTION("answer containment queries")
+  {
+    const std::vector<SectionRange> queries{{50, 50}, {1, 99}, {10, 20}, ranges[0], ranges[7], {0, 0}, {100, 100}};
+    const auto counts = index.CountContaining(queries);
+
+    for (std::size_t query = 0; query < queries.size(); ++query)
+    {
+      std::vector<std::size_t> expected;
+      for (std::size_t i = 0; i < ranges.size(); ++i)
+      {
+        if (contains(ranges[i], queries[query]))
+        {
+          expected.push_back(i);
+        }
+      }
+      CHECK(expected.size() == counts[query]);
+      CHECK(expected == index.FindContaining(queries[query]));
+    }
+  }
+}
+
+TEST_CASE("section coverage")
+{
+  SECTION("example assignments")
+  {
+    const SectionCoverage coverage{ParseAssignmentPairs("2-4,6-8\n2-3,4-5\n5-7,7-9\n2-8,3-7\n6-6,4-6\n2-6,4-8")};
+
+    CHECK(0 == coverage.CountCovering(1));
+    CHECK(4 == coverage.CountCovering(2));
+    CHECK(8 == coverage.CountCovering(6));
+    CHECK(1 == coverage.CountCovering(9));
+    CHECK(0 == coverage.CountCovering(10));
+    CHECK(8 == coverage.GetCoveredSectionsCount());
+    CHECK(8 == coverage.GetMaxDepth());
+  }
+
+  SECTION("same results as counting assignments")
+  {
+    std::fstream my_file;
+    my_file.open("day4_data.txt", std::ios::in);
+    const auto pairs = ReadAssignmentPairs(my_file);
+    const SectionCoverage coverage{pairs};
+
+    std::vector<std::uint32_t> sections(101);
+    std::iota(sections.begin(), sections.end(), std::uint32_t{0});
+    const auto counts = coverage.CountCovering(sections, 4);
+
+    std::uint64_t covered = 0;
+    std::size_t maxDepth = 0;
+    for (const auto section : sections)
+    {
+      std::size_t expected = 0;
+      for (std::size_t i = 0; i < pairs.size(); ++i)
+      {
+        expected += pairs.firstBegins[i] <= section and section <= pairs.firstEnds[i];
+        expected += pairs.secondBegins[i] <= section and section <= pairs.secondEnds[i];
+      }
+      CHECK(expected == counts[section]);
+      covered += expected > 0;
+      maxDepth = std::max(maxDepth, expected);
+    }
+    CHECK(covered == coverage.GetCoveredSectionsCount());
+    CHECK(maxDepth == coverage.GetMaxDepth());
+  }
+}
+
 TEST_CASE("count repetitions")
 {
   std::stringstream test{};
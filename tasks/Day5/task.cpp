@@ -1,8 +1,16 @@
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <fstream>
 #include <iostream>
-#include <stack>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace
 {
@@ -11,11 +19,12 @@ namespace
   class Cargo
   {
     public:
-    using Stack = std::stack<char>;
+    // Crates from the bottom to the top of the stack.
+    using Stack = std::vector<char>;
     using Stacks = std::vector<Stack>;
     
-    Cargo(Stacks stacks)
-     : stacks(stacks)
+    Cargo(Stacks initialStacks)
+     : stacks(std::move(initialStacks))
     {
     }
 
@@ -26,7 +35,7 @@ namespace
       {
         if (!stack.empty())
         {
-          top += stack.top();
+          top += stack.back();
         }
       }
       return top;
@@ -34,40 +43,244 @@ namespace
 
     void MoveElementsByOneFromTo(size_t count, size_t from, size_t to)
     {
-      for (size_t i = 0; i < count; i++)
+      auto& source = stacks.at(from);
+      auto& target = stacks.at(to);
+      if (&source == &target)
       {
-        if (!stacks.at(from).empty())
+        return;
+      }
+
+      count = std::min(count, source.size());
+      target.insert(target.end(), source.rbegin(), source.rbegin() + static_cast<std::ptrdiff_t>(count));
+      source.resize(source.size() - count);
+    }
+
+    void MoveElementsFromTo(size_t count, size_t from, size_t to)
+    {
+      auto& source = stacks.at(from);
+      auto& target = stacks.at(to);
+      if (&source == &target)
+      {
+        return;
+      }
+
+      count = std::min(count, source.size());
+      target.insert(target.end(), source.end() - static_cast<std::ptrdiff_t>(count), source.end());
+      source.resize(source.size() - count);
+    }
+
+    const Stacks& GetStacks() const
+    {
+      return stacks;
+    }
+
+    private:
+    Stacks stacks;
+  };
+
+  // Cargo backend keeping every stack as a sequence of chunks, so a move splices whole chunks
+  // and copies crates of the edge chunk only. Chunks moved one by one are reversed lazily.
+  class RopeCargo
+  {
+    public:
+    static constexpr size_t defaultChunkSize = 4096;
+
+    RopeCargo(const Cargo::Stacks& initialStacks, size_t maxChunkSize = defaultChunkSize)
+     : chunkSize(std::max<size_t>(maxChunkSize, 1)),
+       stacks(initialStacks.size())
+    {
+      for (size_t i = 0; i < initialStacks.size(); ++i)
+      {
+        const auto& crates = initialStacks[i];
+        for (size_t begin = 0; begin < crates.size(); begin += chunkSize)
         {
-          const auto elem = stacks.at(from).top();
-          stacks.at(to).push(elem);
-          stacks.at(from).pop();
+          const auto end = std::min(begin + chunkSize, crates.size());
+          stacks[i].push_back(Chunk{{crates.begin() + static_cast<std::ptrdiff_t>(begin),
+                                     crates.begin() + static_cast<std::ptrdiff_t>(end)}, 0, end - begin, false});
         }
       }
     }
 
-    void MoveElementsFromTo(size_t count, size_t from, size_t to)
+    std::string GetStacksTop() const
     {
-      std::vector<char> temp{};
-      for (size_t i = 0; i < count; i++)
+      std::string top;
+      for (const auto& stack : stacks)
       {
-        if (!stacks.at(from).empty())
+        if (!stack.empty())
         {
-          const auto elem = stacks.at(from).top();
-          stacks.at(from).pop();
-          temp.push_back(elem);
+          top += stack.back().At(stack.back().size() - 1);
         }
       }
-      std::for_each(temp.rbegin(), temp.rend(), [&](const auto& elem) {stacks.at(to).push(elem);});
+      return top;
+    }
+
+    Cargo::Stacks GetStacks() const
+    {
+      Cargo::Stacks result(stacks.size());
+      for (size_t i = 0; i < stacks.size(); ++i)
+      {
+        for (const auto& chunk : stacks[i])
+        {
+          for (size_t crate = 0; crate < chunk.size(); ++crate)
+          {
+            result[i].push_back(chunk.At(crate));
+          }
+        }
+      }
+      return result;
+    }
+
+    void MoveElementsByOneFromTo(size_t count, size_t from, size_t to)
+    {
+      Move(count, from, to, true);
+    }
+
+    void MoveElementsFromTo(size_t count, size_t from, size_t to)
+    {
+      Move(count, from, to, false);
     }
 
     private:
-    Stacks stacks;
+    struct Chunk
+    {
+      std::vector<char> crates;
+      size_t begin;
+      size_t end;
+      bool reversed;
+
+      size_t size() const
+      {
+        return end - begin;
+      }
+
+      // Crate at the given position counted from the bottom of the chunk.
+      char At(size_t position) const
+      {
+        return reversed ? crates[end - 1 - position] : crates[begin + position];
+      }
+
+      // Cuts off the given number of crates from the top of the chunk.
+      Chunk SplitTop(size_t count)
+      {
+        const auto first = reversed ? begin : end - count;
+        Chunk top{{crates.begin() + static_cast<std::ptrdiff_t>(first),
+                   crates.begin() + static_cast<std::ptrdiff_t>(first + count)}, 0, count, reversed};
+        if (reversed)
+        {
+          begin += count;
+        }
+        else
+        {
+          end -= count;
+        }
+        return top;
+      }
+    };
+
+    using Stack = std::vector<Chunk>;
+
+    void Move(size_t count, size_t from, size_t to, bool movingByOne)
+    {
+      auto& source = stacks.at(from);
+      auto& target = stacks.at(to);
+      if (&source == &target)
+      {
+        return;
+      }
+
+      auto firstMoved = source.size();
+      while (count > 0 and firstMoved > 0 and source[firstMoved - 1].size() <= count)
+      {
+        count -= source[--firstMoved].size();
+      }
+
+      std::optional<Chunk> edge;
+      if (count > 0 and firstMoved > 0)
+      {
+        edge = source[firstMoved - 1].SplitTop(count);
+      }
+
+      const auto junction = target.size();
+      if (movingByOne)
+      {
+        for (auto chunk = source.size(); chunk-- > firstMoved;)
+        {
+          source[chunk].reversed = !source[chunk].reversed;
+          target.push_back(std::move(source[chunk]));
+        }
+        if (edge)
+        {
+          edge->reversed = !edge->reversed;
+          target.push_back(std::move(*edge));
+        }
+      }
+      else
+      {
+        if (edge)
+        {
+          target.push_back(std::move(*edge));
+        }
+        for (auto chunk = firstMoved; chunk < source.size(); ++chunk)
+        {
+          target.push_back(std::move(source[chunk]));
+        }
+      }
+      source.resize(firstMoved);
+
+      // Merge the moved chunks first, so the junction merge only copies moved crates.
+      if (target.size() - junction > 1)
+      {
+        MergeIfSmall(target, target.size() - 1);
+      }
+      MergeIfSmall(target, junction);
+    }
+
+    // Appends the chunk at the given position onto the one below it when both fit into one chunk.
+    // Every chunk owns its buffer, so the lower one is trimmed and extended in place: only the upper
+    // crates are copied, and a reversed lower chunk is straightened once, paid by the move that flipped it.
+    void MergeIfSmall(Stack& stack, size_t position)
+    {
+      if (position == 0 or position >= stack.size())
+      {
+        return;
+      }
+
+      auto& lower = stack[position - 1];
+      const auto& upper = stack[position];
+      if (lower.size() + upper.size() > chunkSize)
+      {
+        return;
+      }
+
+      if (lower.reversed)
+      {
+        std::reverse(lower.crates.begin() + static_cast<std::ptrdiff_t>(lower.begin),
+                     lower.crates.begin() + static_cast<std::ptrdiff_t>(lower.end));
+        lower.reversed = false;
+      }
+      lower.crates.resize(lower.end);
+      for (size_t crate = 0; crate < upper.size(); ++crate)
+      {
+        lower.crates.push_back(upper.At(crate));
+      }
+      lower.end = lower.crates.size();
+
+      stack.erase(stack.begin() + static_cast<std::ptrdiff_t>(position));
+    }
+
+    size_t chunkSize;
+    std::vector<Stack> stacks;
   };
 
   class CargoFactory
   {
     public:
       static Cargo MakeCargo(std::vector<std::string> input)
+      {
+        return MakeStacks(std::move(input));
+      }
+
+      static Cargo::Stacks MakeStacks(std::vector<std::string> input)
       {
         constexpr auto columnSize = 3;
         constexpr auto elemPositionInColumn = 2;
@@ -83,7 +296,7 @@ namespace
             const auto elem = line.at(i*columnSize + elemPositionInColumn + i * separatorSize - separatorSize);
             if(isupper(elem))
             {
-              stacks.at(i).push(elem);
+              stacks.at(i).push_back(elem);
             }
           }
         }
@@ -92,7 +305,7 @@ namespace
       }
   };
 
-Cargo ReadFileAndCreateCargo(std::basic_istream<char>& inputData)
+Cargo::Stacks ReadStacks(std::basic_istream<char>& inputData)
 {
   std::string segment{};
   std::vector<std::string> inputCargo;
@@ -106,7 +319,7 @@ Cargo ReadFileAndCreateCargo(std::basic_istream<char>& inputData)
     inputCargo.push_back(segment);
   }
 
-  return CargoFactory().MakeCargo(std::vector<std::string>{inputCargo.rbegin(), inputCargo.rend()});
+  return CargoFactory().MakeStacks(std::vector<std::string>{inputCargo.rbegin(), inputCargo.rend()});
 }
 
 std::vector<int> ExtractIntegerWords(std::string str)
@@ -131,38 +344,416 @@ std::vector<int> ExtractIntegerWords(std::string str)
     return foundings;
 }
 
-std::string GetCargoTopPositionsWhenMovingByOne(std::basic_istream<char>& inputData)
+struct Move
 {
-  auto cargo = ReadFileAndCreateCargo(inputData);
+  size_t count;
+  size_t from;
+  size_t to;
+};
 
+std::vector<Move> ReadMoves(std::basic_istream<char>& inputData)
+{
+  std::vector<Move> moves;
   std::string segment{};
   while (std::getline(inputData, segment))
   {
-    const auto moves = ExtractIntegerWords(segment);
+    const auto move = ExtractIntegerWords(segment);
+    moves.push_back({static_cast<size_t>(move.at(0)),
+                     static_cast<size_t>(move.at(1) - 1),
+                     static_cast<size_t>(move.at(2) - 1)});
+  }
+  return moves;
+}
+
+struct CargoInput
+{
+  Cargo::Stacks stacks;
+  std::vector<Move> moves;
+};
+
+// Reads the drawing column by column straight into the stacks, then decodes every move line,
+// in one pass over the buffer.
+CargoInput ParseCargoInput(std::string_view input)
+{
+  constexpr size_t columnSize = 4;
+  constexpr size_t elemPositionInColumn = 1;
+
+  CargoInput result;
+  size_t pos = 0;
+  std::string_view lastLine;
+
+  while (pos < input.size())
+  {
+    auto lineEnd = input.find('\n', pos);
+    if (lineEnd == std::string_view::npos)
+    {
+      lineEnd = input.size();
+    }
+    const auto line = input.substr(pos, lineEnd - pos);
+    pos = lineEnd + 1;
+
+    if (line.empty() or line == "\r")
+    {
+      break;
+    }
+    lastLine = line;
+
+    for (auto column = elemPositionInColumn; column < line.size(); column += columnSize)
+    {
+      if (isupper(line[column]))
+      {
+        if (result.stacks.size() <= column / columnSize)
+        {
+          result.stacks.resize(column / columnSize + 1);
+        }
+        result.stacks[column / columnSize].push_back(line[column]);
+      }
+    }
+  }
+
+  // The number line under the drawing names the last stack, which may start empty.
+  size_t stacksCount = 0;
+  const auto lastDigit = lastLine.find_last_of("0123456789");
+  if (lastDigit != std::string_view::npos)
+  {
+    const auto beforeNumber = lastLine.find_last_not_of("0123456789", lastDigit);
+    for (auto digit = beforeNumber == std::string_view::npos ? 0 : beforeNumber + 1; digit <= lastDigit; ++digit)
+    {
+      stacksCount = stacksCount * 10 + static_cast<size_t>(lastLine[digit] - '0');
+    }
+  }
+  if (result.stacks.size() < stacksCount)
+  {
+    result.stacks.resize(stacksCount);
+  }
+
+  for (auto& stack : result.stacks)
+  {
+    std::reverse(stack.begin(), stack.end());
+  }
+
+  std::array<size_t, 3> numbers{};
+  size_t numbersCount = 0;
+  bool inNumber = false;
+
+  for (; pos <= input.size(); ++pos)
+  {
+    const auto c = pos < input.size() ? input[pos] : '\n';
+    if (c >= '0' and c <= '9')
+    {
+      if (not inNumber)
+      {
+        ++numbersCount;
+        if (numbersCount <= numbers.size())
+        {
+          numbers[numbersCount - 1] = 0;
+        }
+      }
+      // Digits after the third number are ignored.
+      if (numbersCount <= numbers.size())
+      {
+        numbers[numbersCount - 1] = numbers[numbersCount - 1] * 10 + static_cast<size_t>(c - '0');
+      }
+      inNumber = true;
+      continue;
+    }
 
-    cargo.MoveElementsByOneFromTo(static_cast<size_t>(moves.at(0)), 
-                                  static_cast<size_t>(moves.at(1) - 1), 
-                                  static_cast<size_t>(moves.at(2) - 1));
+    inNumber = false;
+    if (c == '\n')
+    {
+      if (numbersCount >= numbers.size())
+      {
+        result.moves.push_back({numbers[0], numbers[1] - 1, numbers[2] - 1});
+      }
+      numbersCount = 0;
+    }
+  }
+
+  return result;
+}
+
+CargoInput ReadCargoInput(std::basic_istream<char>& inputData)
+{
+  const std::string input{std::istreambuf_iterator<char>{inputData}, std::istreambuf_iterator<char>{}};
+  return ParseCargoInput(input);
+}
+
+template <typename CargoType = Cargo>
+std::string GetCargoTopPositionsWhenMovingByOne(std::basic_istream<char>& inputData)
+{
+  auto input = ReadCargoInput(inputData);
+  CargoType cargo{std::move(input.stacks)};
+
+  for (const auto& move : input.moves)
+  {
+    cargo.MoveElementsByOneFromTo(move.count, move.from, move.to);
   }
   return cargo.GetStacksTop();
 }
 
+template <typename CargoType = Cargo>
 std::string GetCargoTopPositions(std::basic_istream<char>& inputData)
 {
-  auto cargo = ReadFileAndCreateCargo(inputData);
+  auto input = ReadCargoInput(inputData);
+  CargoType cargo{std::move(input.stacks)};
 
-  std::string segment{};
-  while (std::getline(inputData, segment))
+  for (const auto& move : input.moves)
   {
-    const auto moves = ExtractIntegerWords(segment);
-
-    cargo.MoveElementsFromTo(static_cast<size_t>(moves.at(0)), 
-                             static_cast<size_t>(moves.at(1) - 1), 
-                             static_cast<size_t>(moves.at(2) - 1));
+    cargo.MoveElementsFromTo(move.count, move.from, move.to);
   }
   return cargo.GetStacksTop();
 }
 
+// Follows every final stack top backwards through the moves to its place in the initial stacks,
+// so the cost does not depend on how many crates are stacked or moved.
+std::string TraceStacksTop(const Cargo::Stacks& stacks, const std::vector<Move>& moves, bool movingByOne)
+{
+  std::vector<size_t> heights;
+  for (const auto& stack : stacks)
+  {
+    heights.push_back(stack.size());
+  }
+
+  std::vector<size_t> movedCounts;
+  movedCounts.reserve(moves.size());
+  for (const auto& move : moves)
+  {
+    const auto moved = move.from == move.to ? 0 : std::min(move.count, heights.at(move.from));
+    heights.at(move.from) -= moved;
+    heights.at(move.to) += moved;
+    movedCounts.push_back(moved);
+  }
+
+  std::string top;
+  for (size_t stack = 0; stack < stacks.size(); ++stack)
+  {
+    if (heights[stack] == 0)
+    {
+      continue;
+    }
+
+    auto current = stack;
+    size_t depth = 0;
+    for (auto i = moves.size(); i-- > 0;)
+    {
+      const auto moved = movedCounts[i];
+      if (current == moves[i].to and depth < moved)
+      {
+        current = moves[i].from;
+        depth = movingByOne ? moved - 1 - depth : depth;
+      }
+      else if (current == moves[i].to)
+      {
+        depth -= moved;
+      }
+      else if (current == moves[i].from)
+      {
+        depth += moved;
+      }
+    }
+    top += stacks[current][stacks[current].size() - 1 - depth];
+  }
+  return top;
+}
+
+std::string TraceCargoTopPositionsWhenMovingByOne(std::basic_istream<char>& inputData)
+{
+  const auto stacks = ReadStacks(inputData);
+  return TraceStacksTop(stacks, ReadMoves(inputData), true);
+}
+
+std::string TraceCargoTopPositions(std::basic_istream<char>& inputData)
+{
+  const auto stacks = ReadStacks(inputData);
+  return TraceStacksTop(stacks, ReadMoves(inputData), false);
+}
+
+// Groups moves into waves: a move goes one wave after the last earlier move touching either of
+// its stacks, so moves inside a wave touch disjoint stacks and keep their relative order.
+std::vector<std::vector<Move>> ScheduleMoveWaves(const std::vector<Move>& moves, size_t stacksCount)
+{
+  std::vector<size_t> stackWaves(stacksCount);
+  std::vector<std::vector<Move>> waves;
+
+  for (const auto& move : moves)
+  {
+    const auto wave = std::max(stackWaves.at(move.from), stackWaves.at(move.to));
+    if (wave == waves.size())
+    {
+      waves.emplace_back();
+    }
+    waves[wave].push_back(move);
+    stackWaves[move.from] = wave + 1;
+    stackWaves[move.to] = wave + 1;
+  }
+  return waves;
+}
+
+// Every stack is owned by a single move of a wave, so the moves of a wave run without locks.
+void ExecuteMovesInWaves(Cargo& cargo, const std::vector<Move>& moves, bool movingByOne, size_t threadsCount)
+{
+  constexpr size_t minimalMovesPerThread = 64;
+
+  const auto apply = [&cargo, movingByOne](const Move& move)
+  {
+    if (movingByOne)
+    {
+      cargo.MoveElementsByOneFromTo(move.count, move.from, move.to);
+    }
+    else
+    {
+      cargo.MoveElementsFromTo(move.count, move.from, move.to);
+    }
+  };
+
+  for (const auto& wave : ScheduleMoveWaves(moves, cargo.GetStacks().size()))
+  {
+    const auto workersCount = std::min(std::max<size_t>(threadsCount, 1), std::max<size_t>(wave.size() / minimalMovesPerThread, 1));
+    if (workersCount == 1)
+    {
+      std::for_each(wave.begin(), wave.end(), apply);
+      continue;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t worker = 0; worker < workersCount; ++worker)
+    {
+      workers.emplace_back([&, worker]()
+      {
+        const auto end = wave.size() * (worker + 1) / workersCount;
+        for (auto move = wave.size() * worker / workersCount; move < end; ++move)
+        {
+          apply(wave[move]);
+        }
+      });
+    }
+    for (auto& worker : workers)
+    {
+      worker.join();
+    }
+  }
+}
+
+// Keeps a snapshot of all stacks every snapshotInterval moves together with an undo record for
+// every move, so the state after any move is restored from the nearest snapshot.
+class MoveJournal
+{
+  public:
+  MoveJournal(const Cargo::Stacks& initialStacks, const std::vector<Move>& moves, bool movingByOne, size_t snapshotInterval)
+   : interval(std::max<size_t>(snapshotInterval, 1)),
+     byOne(movingByOne)
+  {
+    Cargo cargo{initialStacks};
+    snapshots.push_back(MakeSnapshot(cargo.GetStacks()));
+    undoRecords.reserve(moves.size());
+
+    for (const auto& move : moves)
+    {
+      const auto& stacks = cargo.GetStacks();
+      const auto moved = move.from == move.to ? 0 : std::min(move.count, stacks.at(move.from).size());
+      undoRecords.push_back({moved, move.to, move.from});
+      Apply(cargo, move);
+
+      if (undoRecords.size() % interval == 0)
+      {
+        snapshots.push_back(MakeSnapshot(cargo.GetStacks()));
+      }
+    }
+  }
+
+  size_t size() const
+  {
+    return undoRecords.size();
+  }
+
+  // Stacks after the first movesCount moves.
+  Cargo::Stacks GetStacksAfter(size_t movesCount) const
+  {
+    movesCount = std::min(movesCount, size());
+    const auto previous = movesCount / interval;
+    const auto next = previous + 1;
+
+    if (next < snapshots.size() and next * interval - movesCount < movesCount - previous * interval)
+    {
+      Cargo cargo{RestoreSnapshot(snapshots[next])};
+      for (auto move = next * interval; move-- > movesCount;)
+      {
+        Apply(cargo, undoRecords[move]);
+      }
+      return cargo.GetStacks();
+    }
+
+    Cargo cargo{RestoreSnapshot(snapshots[previous])};
+    for (auto move = previous * interval; move < movesCount; ++move)
+    {
+      const auto& undo = undoRecords[move];
+      Apply(cargo, {undo.count, undo.to, undo.from});
+    }
+    return cargo.GetStacks();
+  }
+
+  std::string GetStacksTopAfter(size_t movesCount) const
+  {
+    return Cargo{GetStacksAfter(movesCount)}.GetStacksTop();
+  }
+
+  private:
+  // All crates in one buffer with the end offset of every stack.
+  struct Snapshot
+  {
+    std::string crates;
+    std::vector<size_t> ends;
+  };
+
+  static Snapshot MakeSnapshot(const Cargo::Stacks& stacks)
+  {
+    Snapshot snapshot;
+    for (const auto& stack : stacks)
+    {
+      snapshot.crates.append(stack.begin(), stack.end());
+      snapshot.ends.push_back(snapshot.crates.size());
+    }
+    return snapshot;
+  }
+
+  static Cargo::Stacks RestoreSnapshot(const Snapshot& snapshot)
+  {
+    Cargo::Stacks stacks;
+    size_t begin = 0;
+    for (const auto end : snapshot.ends)
+    {
+      stacks.emplace_back(snapshot.crates.begin() + static_cast<std::ptrdiff_t>(begin),
+                          snapshot.crates.begin() + static_cast<std::ptrdiff_t>(end));
+      begin = end;
+    }
+    return stacks;
+  }
+
+  void Apply(Cargo& cargo, const Move& move) const
+  {
+    if (byOne)
+    {
+      cargo.MoveElementsByOneFromTo(move.count, move.from, move.to);
+    }
+    else
+    {
+      cargo.MoveElementsFromTo(move.count, move.from, move.to);
+    }
+  }
+
+  size_t interval;
+  bool byOne;
+  std::vector<Snapshot> snapshots;
+  std::vector<Move> undoRecords;
+};
+
+// Deterministic pseudo-random sequence for generated test inputs.
+size_t NextRandom(size_t& state)
+{
+  state = state * 6364136223846793005u + 1442695040888963407u;
+  return state;
+}
+
 };
 
 
@@ -170,9 +761,9 @@ TEST_CASE("Cargo")
 {
   SECTION("Create cargo stacks")
   {
-    Cargo::Stack first{std::deque<char>{'A', 'A'}};
-    Cargo::Stack second{std::deque<char>{'C', 'B'}};
-    Cargo::Stack third{std::deque<char>{'D', 'C'}};
+    Cargo::Stack first{'A', 'A'};
+    Cargo::Stack second{'C', 'B'};
+    Cargo::Stack third{'D', 'C'};
     Cargo::Stacks stacks{{first, second, third}};
 
     Cargo cargo{stacks};
@@ -197,6 +788,16 @@ TEST_CASE("Cargo")
 
       CHECK("ACA" == cargo.GetStacksTop());
     }
+
+    SECTION("move more elements than stack holds")
+    {
+      cargo.MoveElementsByOneFromTo(5, 0, 1);
+      CHECK("AC" == cargo.GetStacksTop());
+
+      cargo.MoveElementsFromTo(2, 1, 1);
+      cargo.MoveElementsFromTo(5, 1, 2);
+      CHECK("A" == cargo.GetStacksTop());
+    }
   }
 }
 
@@ -242,6 +843,304 @@ TEST_CASE("check top positions for data example")
   }
 }
 
+TEST_CASE("trace top positions backwards")
+{
+  SECTION("data example")
+  {
+    std::stringstream test{};
+    test << "    [D]    \n";
+    test << "[N] [C]    \n";
+    test << "[Z] [M] [P]\n";
+    test << " 1   2   3 \n";
+    test << "\n";
+    test << "move 1 from 2 to 1\n";
+    test << "move 3 from 1 to 3\n";
+    test << "move 2 from 2 to 1\n";
+    test << "move 1 from 1 to 2\n";
+
+    SECTION("one by one")
+    {
+      CHECK("CMZ" == TraceCargoTopPositionsWhenMovingByOne(test));
+    }
+
+    SECTION("all at once")
+    {
+      CHECK("MCD" == TraceCargoTopPositions(test));
+    }
+  }
+
+  SECTION("same result as simulation")
+  {
+    std::fstream my_file;
+    my_file.open("day5_data.txt", std::ios::in);
+    const auto stacks = ReadStacks(my_file);
+    auto moves = ReadMoves(my_file);
+    moves.push_back({100, 0, 1});
+    moves.push_back({3, 2, 2});
+
+    Cargo byOne{stacks};
+    Cargo allAtOnce{stacks};
+    for (const auto& move : moves)
+    {
+      byOne.MoveElementsByOneFromTo(move.count, move.from, move.to);
+      allAtOnce.MoveElementsFromTo(move.count, move.from, move.to);
+    }
+
+    CHECK(byOne.GetStacksTop() == TraceStacksTop(stacks, moves, true));
+    CHECK(allAtOnce.GetStacksTop() == TraceStacksTop(stacks, moves, false));
+  }
+}
+
+TEST_CASE("Rope cargo")
+{
+  std::fstream my_file;
+  my_file.open("day5_data.txt", std::ios::in);
+  const auto stacks = ReadStacks(my_file);
+  auto moves = ReadMoves(my_file);
+  moves.push_back({100, 0, 1});
+  moves.push_back({3, 2, 2});
+  moves.push_back({7, 4, 5});
+
+  for (const auto chunkSize : std::vector<size_t>{1, 2, 3, 5, 64})
+  {
+    Cargo byOne{stacks};
+    Cargo allAtOnce{stacks};
+    RopeCargo ropeByOne{stacks, chunkSize};
+    RopeCargo ropeAllAtOnce{stacks, chunkSize};
+
+    for (const auto& move : moves)
+    {
+      byOne.MoveElementsByOneFromTo(move.count, move.from, move.to);
+      allAtOnce.MoveElementsFromTo(move.count, move.from, move.to);
+      ropeByOne.MoveElementsByOneFromTo(move.count, move.from, move.to);
+      ropeAllAtOnce.MoveElementsFromTo(move.count, move.from, move.to);
+    }
+
+    CHECK(byOne.GetStacks() == ropeByOne.GetStacks());
+    CHECK(allAtOnce.GetStacks() == ropeAllAtOnce.GetStacks());
+    CHECK(byOne.GetStacksTop() == ropeByOne.GetStacksTop());
+    CHECK(allAtOnce.GetStacksTop() == ropeAllAtOnce.GetStacksTop());
+  }
+
+  SECTION("select backend for data example")
+  {
+    std::stringstream test{};
+    test << "    [D]    \n";
+    test << "[N] [C]    \n";
+    test << "[Z] [M] [P]\n";
+    test << " 1   2   3 \n";
+    test << "\n";
+    test << "move 1 from 2 to 1\n";
+    test << "move 3 from 1 to 3\n";
+    test << "move 2 from 2 to 1\n";
+    test << "move 1 from 1 to 2\n";
+    std::stringstream test2{test.str()};
+
+    CHECK("CMZ" == GetCargoTopPositionsWhenMovingByOne<RopeCargo>(test));
+    CHECK("MCD" == GetCargoTopPositions<RopeCargo>(test2));
+  }
+
+  SECTION("many small moves stay close to vector cargo")
+  {
+    Cargo::Stacks bigStacks(9);
+    for (size_t stack = 0; stack < bigStacks.size(); ++stack)
+    {
+      bigStacks[stack].assign(5000, static_cast<char>('A' + stack));
+    }
+
+    std::vector<Move> smallMoves;
+    size_t seed = 3;
+    for (size_t move = 0; move < 200000; ++move)
+    {
+      const auto random = NextRandom(seed);
+      smallMoves.push_back({1 + (random >> 62), (random >> 20) % bigStacks.size(), (random >> 40) % bigStacks.size()});
+    }
+
+    const auto measure = [&smallMoves](auto& cargo)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      for (const auto& move : smallMoves)
+      {
+        cargo.MoveElementsByOneFromTo(move.count, move.from, move.to);
+      }
+      return std::chrono::steady_clock::now() - start;
+    };
+
+    Cargo cargo{bigStacks};
+    RopeCargo rope{bigStacks};
+    const auto cargoTime = measure(cargo);
+    const auto ropeTime = measure(rope);
+
+    CHECK(cargo.GetStacks() == rope.GetStacks());
+    // Copying whole chunks per move made this two to three orders of magnitude slower.
+    CHECK(ropeTime < 20 * cargoTime + std::chrono::milliseconds{200});
+  }
+}
+
+TEST_CASE("Move journal")
+{
+  std::fstream my_file;
+  my_file.open("day5_data.txt", std::ios::in);
+  const auto stacks = ReadStacks(my_file);
+  auto moves = ReadMoves(my_file);
+  moves.push_back({100, 0, 1});
+  moves.push_back({3, 2, 2});
+
+  for (const bool movingByOne : {true, false})
+  {
+    std::vector<Cargo::Stacks> states{stacks};
+    Cargo cargo{stacks};
+    for (const auto& move : moves)
+    {
+      if (movingByOne)
+      {
+        cargo.MoveElementsByOneFromTo(move.count, move.from, move.to);
+      }
+      else
+      {
+        cargo.MoveElementsFromTo(move.count, move.from, move.to);
+      }
+      states.push_back(cargo.GetStacks());
+    }
+
+    for (const auto interval : std::vector<size_t>{1, 7, 64, 1000})
+    {
+      const MoveJournal journal{stacks, moves, movingByOne, interval};
+      CHECK(moves.size() == journal.size());
+
+      for (size_t movesCount = 0; movesCount <= moves.size(); movesCount += 13)
+      {
+        CHECK(states[movesCount] == journal.GetStacksAfter(movesCount));
+      }
+      CHECK(cargo.GetStacksTop() == journal.GetStacksTopAfter(moves.size()));
+      CHECK(Cargo{stacks}.GetStacksTop() == journal.GetStacksTopAfter(0));
+    }
+  }
+}
+
+TEST_CASE("Execute moves in waves")
+{
+  SECTION("schedule independent moves together")
+  {
+    const std::vector<Move> moves{{3, 0, 1}, {5, 3, 6}, {1, 1, 2}, {2, 4, 5}, {1, 6, 0}};
+    const auto waves = ScheduleMoveWaves(moves, 7);
+
+    REQUIRE(2 == waves.size());
+    CHECK(3 == waves[0].size());
+    CHECK(2 == waves[1].size());
+    CHECK(1 == waves[1][0].from);
+    CHECK(6 == waves[1][1].from);
+  }
+
+  SECTION("same result as sequential moves")
+  {
+    Cargo::Stacks stacks(1000);
+    for (size_t stack = 0; stack < stacks.size(); ++stack)
+    {
+      stacks[stack].assign(stack % 17 + 1, static_cast<char>('A' + stack % 26));
+    }
+
+    std::vector<Move> moves;
+    size_t seed = 12345;
+    for (size_t move = 0; move < 20000; ++move)
+    {
+      const auto random = NextRandom(seed);
+      moves.push_back({random >> 60, (random >> 20) % stacks.size(), (random >> 40) % stacks.size()});
+    }
+
+    for (const bool movingByOne : {true, false})
+    {
+      Cargo sequential{stacks};
+      Cargo parallel{stacks};
+      for (const auto& move : moves)
+      {
+        if (movingByOne)
+        {
+          sequential.MoveElementsByOneFromTo(move.count, move.from, move.to);
+        }
+        else
+        {
+          sequential.MoveElementsFromTo(move.count, move.from, move.to);
+        }
+      }
+      ExecuteMovesInWaves(parallel, moves, movingByOne, 4);
+
+      CHECK(sequential.GetStacks() == parallel.GetStacks());
+    }
+  }
+}
+
+TEST_CASE("Parse cargo input in one pass")
+{
+  SECTION("data example")
+  {
+    const auto input = ParseCargoInput("    [D]    \n"
+                                       "[N] [C]    \n"
+                                       "[Z] [M] [P]\n"
+                                       " 1   2   3 \n"
+                                       "\n"
+                                       "move 1 from 2 to 1\n"
+                                       "move 13 from 1 to 3\r\n"
+                                       "move 2 from 2 to 1");
+
+    CHECK(Cargo::Stacks{{'Z', 'N'}, {'M', 'C', 'D'}, {'P'}} == input.stacks);
+    REQUIRE(3 == input.moves.size());
+    CHECK(13 == input.moves[1].count);
+    CHECK(0 == input.moves[1].from);
+    CHECK(2 == input.moves[1].to);
+    CHECK(1 == input.moves[2].from);
+  }
+
+  SECTION("drawing line ending in a crate letter")
+  {
+    const auto input = ParseCargoInput("[A] [B\n"
+                                       " 1   2 \n"
+                                       "\n"
+                                       "move 1 from 1 to 2 7\n");
+
+    CHECK(Cargo::Stacks{{'A'}, {'B'}} == input.stacks);
+    REQUIRE(1 == input.moves.size());
+    CHECK(1 == input.moves[0].count);
+    CHECK(0 == input.moves[0].from);
+    CHECK(1 == input.moves[0].to);
+  }
+
+  SECTION("last stack starting empty")
+  {
+    const std::string drawing{"[A]        \n"
+                              "[B] [C]    \n"
+                              " 1   2   3 \n"
+                              "\n"
+                              "move 1 from 1 to 3\n"};
+
+    CHECK(Cargo::Stacks{{'B', 'A'}, {'C'}, {}} == ParseCargoInput(drawing).stacks);
+
+    std::stringstream test{drawing};
+    CHECK("BCA" == GetCargoTopPositions(test));
+  }
+
+  SECTION("same result as line parser")
+  {
+    std::fstream my_file;
+    my_file.open("day5_data.txt", std::ios::in);
+    const auto stacks = ReadStacks(my_file);
+    const auto moves = ReadMoves(my_file);
+
+    my_file.clear();
+    my_file.seekg(0);
+    const auto input = ReadCargoInput(my_file);
+
+    CHECK(stacks == input.stacks);
+    REQUIRE(moves.size() == input.moves.size());
+    for (size_t move = 0; move < moves.size(); ++move)
+    {
+      CHECK(moves[move].count == input.moves[move].count);
+      CHECK(moves[move].from == input.moves[move].from);
+      CHECK(moves[move].to == input.moves[move].to);
+    }
+  }
+}
+
 TEST_CASE("read day 5 task 1 data")
 {
   std::fstream my_file;
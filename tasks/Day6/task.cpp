@@ -1,35 +1,284 @@
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <fstream>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 namespace
 {
 
-int FindHeaderPositionOfSize(std::basic_istream<char>& buffer, const size_t headerSize)
+// Length of the run of distinct bytes ending at the last pushed byte. Keeps the position after
+// the last occurrence of every byte value, so each byte costs O(1).
+class DistinctRunTracker
+{
+public:
+  size_t Push(char c)
+  {
+    const auto byte = static_cast<unsigned char>(c);
+    windowBegin = std::max(windowBegin, nextAfterLastSeen[byte]);
+    nextAfterLastSeen[byte] = ++position;
+    return position - windowBegin;
+  }
+
+  size_t GetPosition() const
+  {
+    return position;
+  }
+
+private:
+  std::array<size_t, 256> nextAfterLastSeen{};
+  size_t windowBegin = 0;
+  size_t position = 0;
+};
+
+// Position right after the first window of headerSize distinct bytes, or the number of bytes read
+// when there is none.
+template <typename Iterator>
+size_t FindHeaderPosition(Iterator begin, Iterator end, const size_t headerSize)
+{
+  DistinctRunTracker tracker;
+  for (; begin != end; ++begin)
+  {
+    if (tracker.Push(*begin) >= headerSize)
+    {
+      break;
+    }
+  }
+  return tracker.GetPosition();
+}
+
+size_t FindHeaderPosition(std::string_view buffer, const size_t headerSize)
+{
+  return FindHeaderPosition(buffer.begin(), buffer.end(), headerSize);
+}
+
+// Push-based detector for streams arriving in pieces of any size; positions are absolute
+// offsets right after the marker, counted from the first byte ever fed.
+class HeaderDetector
 {
-  char c;
-  std::string header;
-  int counter = 0;
+public:
+  static constexpr size_t noHeader = std::string_view::npos;
 
-  while (buffer.get(c))
+  explicit HeaderDetector(size_t size)
+   : headerSize(size)
   {
-    ++counter;
-    
-    header += c;
+  }
 
-    if (header.size() > headerSize )
+  // Calls onHeader for every marker completed by the fed bytes.
+  template <typename Callback>
+  void Feed(const char* data, size_t size, Callback onHeader)
+  {
+    for (size_t i = 0; i < size; ++i)
     {
-      header = header.substr(1, headerSize);
+      if (tracker.Push(data[i]) >= headerSize)
+      {
+        RememberFirstHeader();
+        onHeader(tracker.GetPosition());
+      }
     }
+  }
+
+  // Position of the first marker completed by the fed bytes, or noHeader.
+  size_t Feed(const char* data, size_t size)
+  {
+    size_t position = noHeader;
+    Feed(data, size, [&position](size_t header){ position = std::min(position, header); });
+    return position;
+  }
 
-    std::set<char> checker{header.begin(), header.end()};
-    if (checker.size() == headerSize)
+  size_t GetFirstHeaderPosition() const
+  {
+    return firstHeaderPosition;
+  }
+
+  size_t GetPosition() const
+  {
+    return tracker.GetPosition();
+  }
+
+private:
+  void RememberFirstHeader()
+  {
+    if (firstHeaderPosition == noHeader)
     {
-      return counter;
+      firstHeaderPosition = tracker.GetPosition();
     }
   }
-  return counter;
+
+  size_t headerSize;
+  size_t firstHeaderPosition = noHeader;
+  DistinctRunTracker tracker;
+};
+
+// FindHeaderPosition for every header size at once: the distinct run ending at a byte answers
+// all sizes up to its length, and it grows by at most one per byte.
+std::vector<size_t> FindHeaderPositions(std::string_view buffer, const std::vector<size_t>& headerSizes)
+{
+  std::vector<size_t> order(headerSizes.size());
+  std::iota(order.begin(), order.end(), size_t{0});
+  std::sort(order.begin(), order.end(), [&headerSizes](size_t lhs, size_t rhs){ return headerSizes[lhs] < headerSizes[rhs]; });
+
+  std::vector<size_t> positions(headerSizes.size(), buffer.size());
+  DistinctRunTracker tracker;
+  auto next = order.begin();
+
+  for (auto c = buffer.begin(); c != buffer.end() and next != order.end(); ++c)
+  {
+    const auto run = tracker.Push(*c);
+    for (; next != order.end() and headerSizes[*next] <= run; ++next)
+    {
+      positions[*next] = tracker.GetPosition();
+    }
+  }
+  return positions;
+}
+
+// Calls onHeader with the position right after every window of headerSize distinct bytes.
+template <typename Callback>
+void ForEachHeaderPosition(std::string_view buffer, const size_t headerSize, Callback onHeader)
+{
+  DistinctRunTracker tracker;
+  for (const auto c : buffer)
+  {
+    if (tracker.Push(c) >= headerSize)
+    {
+      onHeader(tracker.GetPosition());
+    }
+  }
+}
+
+std::vector<size_t> FindAllHeaderPositions(std::string_view buffer, const size_t headerSize)
+{
+  std::vector<size_t> positions;
+  ForEachHeaderPosition(buffer, headerSize, [&positions](size_t position){ positions.push_back(position); });
+  return positions;
+}
+
+size_t CountHeaderPositions(std::string_view buffer, const size_t headerSize)
+{
+  size_t count = 0;
+  DistinctRunTracker tracker;
+  for (const auto c : buffer)
+  {
+    count += tracker.Push(c) >= headerSize;
+  }
+  return count;
+}
+
+// Same result as FindHeaderPosition for lowercase streams. Every candidate window is checked from
+// its right end with one bit per letter; a duplicate at i rules out every window containing i, so
+// the next candidate starts right after it and most bytes are never read for large headers.
+size_t FindLowercaseHeaderPosition(std::string_view buffer, const size_t headerSize)
+{
+  if (headerSize == 0)
+  {
+    return FindHeaderPosition(buffer, headerSize);
+  }
+
+  size_t windowBegin = 0;
+  while (windowBegin + headerSize <= buffer.size())
+  {
+    std::uint32_t seen = 0;
+    auto position = windowBegin + headerSize;
+    bool hasDuplicate = false;
+
+    while (not hasDuplicate and position > windowBegin)
+    {
+      const auto letter = std::uint32_t{1} << (static_cast<unsigned char>(buffer[--position]) % 32);
+      hasDuplicate = seen & letter;
+      seen |= letter;
+    }
+
+    if (not hasDuplicate)
+    {
+      return windowBegin + headerSize;
+    }
+    windowBegin = position + 1;
+  }
+  return buffer.size();
+}
+
+// Same result as FindHeaderPosition. Chunks overlap by headerSize - 1 bytes so every window lies
+// inside one of them; a worker stops as soon as an earlier chunk has already found a marker.
+size_t FindHeaderPositionInParallel(std::string_view buffer, const size_t headerSize, size_t threadsCount)
+{
+  constexpr size_t cancellationCheckInterval = 4096;
+
+  threadsCount = std::max<size_t>(threadsCount, 1);
+  if (headerSize == 0 or buffer.size() < headerSize)
+  {
+    return FindHeaderPosition(buffer, headerSize);
+  }
+
+  std::atomic<size_t> best{std::string_view::npos};
+  const auto worker = [&](size_t chunk)
+  {
+    const auto begin = buffer.size() * chunk / threadsCount;
+    const auto end = std::min(buffer.size() * (chunk + 1) / threadsCount + headerSize - 1, buffer.size());
+
+    std::array<size_t, 256> nextAfterLastSeen{};
+    size_t windowBegin = begin;
+
+    for (auto position = begin; position < end; ++position)
+    {
+      if ((position - begin) % cancellationCheckInterval == 0 and best.load(std::memory_order_relaxed) < begin + headerSize)
+      {
+        return;
+      }
+
+      const auto byte = static_cast<unsigned char>(buffer[position]);
+      windowBegin = std::max(windowBegin, nextAfterLastSeen[byte]);
+      nextAfterLastSeen[byte] = position + 1;
+
+      if (position + 1 - windowBegin >= headerSize)
+      {
+        auto current = best.load();
+        while (position + 1 < current and not best.compare_exchange_weak(current, position + 1))
+        {
+        }
+        return;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t chunk = 0; chunk < threadsCount; ++chunk)
+  {
+    workers.emplace_back(worker, chunk);
+  }
+  for (auto& thread : workers)
+  {
+    thread.join();
+  }
+
+  return best == std::string_view::npos ? buffer.size() : best.load();
+}
+
+int FindHeaderPositionOfSize(std::basic_istream<char>& buffer, const size_t headerSize)
+{
+  return static_cast<int>(FindHeaderPosition(std::istreambuf_iterator<char>{buffer}, std::istreambuf_iterator<char>{}, headerSize));
+}
+
+// Deterministic pseudo-random lowercase stream for tests. The first repetitivePrefix characters
+// use only repetitiveLetters letters, so short headers appear there and long ones only later.
+std::string GenerateLowercaseStream(size_t size, size_t seed, size_t repetitivePrefix, size_t repetitiveLetters)
+{
+  std::string generated;
+  for (size_t i = 0; i < size; ++i)
+  {
+    seed = seed * 6364136223846793005u + 1442695040888963407u;
+    generated += static_cast<char>('a' + (seed >> 33) % (i < repetitivePrefix ? repetitiveLetters : 26));
+  }
+  return generated;
 }
 
 }
@@ -75,6 +324,122 @@ TEST_CASE("read datastream buffer")
   }
 }
 
+TEST_CASE("find header in raw buffer")
+{
+  CHECK(7 == FindHeaderPosition("mjqjpqmgbljsphdztnvjfqwrcgsmlb", 4));
+  CHECK(26 == FindHeaderPosition("zcfzfwzzqfrljwzlrfnpqdbhtmscgvjw", 14));
+  CHECK(4 == FindHeaderPosition("aabb", 3));
+  CHECK(0 == FindHeaderPosition("", 4));
+  CHECK(1 == FindHeaderPosition("a", 1));
+  CHECK(3 == FindHeaderPosition(std::string_view{"\xff\x00\x80", 3}, 3));
+}
+
+TEST_CASE("find lowercase header skipping duplicates")
+{
+  CHECK(7 == FindLowercaseHeaderPosition("mjqjpqmgbljsphdztnvjfqwrcgsmlb", 4));
+  CHECK(29 == FindLowercaseHeaderPosition("nznrnfrfntjfmvfwmzdfjlvtqnbhcprsg", 14));
+  CHECK(4 == FindLowercaseHeaderPosition("aabb", 3));
+  CHECK(0 == FindLowercaseHeaderPosition("", 4));
+
+  std::fstream my_file;
+  my_file.open("day6_data.txt", std::ios::in);
+  const std::string data{std::istreambuf_iterator<char>{my_file}, std::istreambuf_iterator<char>{}};
+
+  const auto generated = GenerateLowercaseStream(5000, 7, 4000, 12);
+
+  for (size_t headerSize = 0; headerSize <= 27; ++headerSize)
+  {
+    CHECK(FindHeaderPosition(data, headerSize) == FindLowercaseHeaderPosition(data, headerSize));
+    CHECK(FindHeaderPosition(generated, headerSize) == FindLowercaseHeaderPosition(generated, headerSize));
+  }
+}
+
+TEST_CASE("find header in parallel")
+{
+  const auto generated = GenerateLowercaseStream(200000, 11, 150000, 10);
+
+  for (const auto headerSize : std::vector<size_t>{0, 1, 4, 10, 11, 14, 26, 27})
+  {
+    for (size_t threadsCount = 1; threadsCount <= 8; ++threadsCount)
+    {
+      CHECK(FindHeaderPosition(generated, headerSize) == FindHeaderPositionInParallel(generated, headerSize, threadsCount));
+      CHECK(FindHeaderPosition("abcabc", headerSize) == FindHeaderPositionInParallel("abcabc", headerSize, threadsCount));
+    }
+  }
+}
+
+TEST_CASE("find headers of many sizes in one pass")
+{
+  std::fstream my_file;
+  my_file.open("day6_data.txt", std::ios::in);
+  const std::string data{std::istreambuf_iterator<char>{my_file}, std::istreambuf_iterator<char>{}};
+
+  SECTION("first position for every size")
+  {
+    const std::vector<size_t> headerSizes{14, 4, 0, 27, 4, 1, 20};
+    const auto positions = FindHeaderPositions(data, headerSizes);
+
+    REQUIRE(headerSizes.size() == positions.size());
+    for (size_t i = 0; i < headerSizes.size(); ++i)
+    {
+      CHECK(FindHeaderPosition(data, headerSizes[i]) == positions[i]);
+    }
+  }
+
+  SECTION("all positions")
+  {
+    CHECK(std::vector<size_t>{3, 4, 5} == FindAllHeaderPositions("abcabba", 3));
+    CHECK(std::vector<size_t>{3, 4, 5, 6} == FindAllHeaderPositions("abcdabb", 3));
+    CHECK(3 == CountHeaderPositions("abcabba", 3));
+
+    for (const auto headerSize : std::vector<size_t>{4, 14})
+    {
+      const auto positions = FindAllHeaderPositions(data, headerSize);
+      CHECK(positions.size() == CountHeaderPositions(data, headerSize));
+      REQUIRE_FALSE(positions.empty());
+      CHECK(FindHeaderPosition(data, headerSize) == positions.front());
+    }
+  }
+}
+
+TEST_CASE("detect headers in fed pieces")
+{
+  SECTION("keep window across feeds")
+  {
+    HeaderDetector detector{4};
+    CHECK(HeaderDetector::noHeader == detector.Feed("mjq", 3));
+    CHECK(HeaderDetector::noHeader == detector.Feed("jpq", 3));
+    CHECK(7 == detector.Feed("mgb", 3));
+    CHECK(10 == detector.Feed("l", 1));
+    CHECK(7 == detector.GetFirstHeaderPosition());
+    CHECK(10 == detector.GetPosition());
+  }
+
+  SECTION("same positions as whole buffer for any piece size")
+  {
+    std::fstream my_file;
+    my_file.open("day6_data.txt", std::ios::in);
+    const std::string data{std::istreambuf_iterator<char>{my_file}, std::istreambuf_iterator<char>{}};
+
+    for (const auto headerSize : std::vector<size_t>{4, 14})
+    {
+      for (size_t pieceSize = 1; pieceSize <= 17; pieceSize += 4)
+      {
+        HeaderDetector detector{headerSize};
+        std::vector<size_t> positions;
+        for (size_t begin = 0; begin < data.size(); begin += pieceSize)
+        {
+          detector.Feed(data.data() + begin, std::min(pieceSize, data.size() - begin),
+                        [&positions](size_t position){ positions.push_back(position); });
+        }
+
+        CHECK(FindHeaderPosition(data, headerSize) == detector.GetFirstHeaderPosition());
+        CHECK(FindAllHeaderPositions(data, headerSize) == positions);
+      }
+    }
+  }
+}
+
 TEST_CASE("read day 6 task 1 data")
 {
   constexpr size_t headerSize = 4;
@@ -1,5 +1,6 @@
 #include <catch2/catch_all.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -16,7 +17,7 @@ namespace
     } type;
     std::string value;
 
-    Token(Type type, std::string value) : type(type), value(value)
+    Token(Type tokenType, std::string tokenValue) : type(tokenType), value(std::move(tokenValue))
     {
     }
 
@@ -53,22 +54,107 @@ namespace
     }
   };
 
-  using DirectoryToSize = std::map<std::string, int>;
+  using DirectoryToSize = std::map<std::string, long long>;
+
+  // Directories are created as `cd` enters them, so every child gets a higher id than its parent.
+  class DirectoryTree
+  {
+  public:
+    struct Directory
+    {
+      std::string name;
+      std::size_t parent;
+      std::map<std::string, std::size_t> children;
+      long long filesSize;
+      long long totalSize;
+    };
+
+    static constexpr std::size_t root = 0;
+
+    DirectoryTree()
+     : directories{{"/", root, {}, 0, 0}}
+    {
+    }
+
+    std::size_t GetOrAddChild(std::size_t parent, const std::string &name)
+    {
+      if (const auto child = directories[parent].children.find(name); child != directories[parent].children.end())
+      {
+        return child->second;
+      }
+
+      const auto child = directories.size();
+      directories.push_back({name, parent, {}, 0, 0});
+      directories[parent].children.emplace(name, child);
+      return child;
+    }
+
+    std::size_t GetParent(std::size_t directory) const
+    {
+      return directories[directory].parent;
+    }
+
+    void AddFile(std::size_t directory, long long size)
+    {
+      directories[directory].filesSize += size;
+    }
+
+    // Post-order accumulation: visiting ids from the highest finishes every child before its parent.
+    void AccumulateSizes()
+    {
+      for (auto &directory : directories)
+      {
+        directory.totalSize = directory.filesSize;
+      }
+      for (auto id = directories.size(); id-- > 1;)
+      {
+        directories[directories[id].parent].totalSize += directories[id].totalSize;
+      }
+    }
+
+    const std::vector<Directory> &GetDirectories() const
+    {
+      return directories;
+    }
+
+    // Path-keyed view for tests; the solvers read GetDirectories() directly.
+    DirectoryToSize ToDirectoryToSize() const
+    {
+      std::vector<std::string> paths(directories.size());
+      DirectoryToSize dirsToSizes;
+      for (std::size_t id = 0; id < directories.size(); ++id)
+      {
+        const auto &directory = directories[id];
+        paths[id] = id == root ? directory.name
+                               : (directory.parent == root ? "" : paths[directory.parent]) + "/" + directory.name;
+        dirsToSizes.emplace(paths[id], directory.totalSize);
+      }
+      return dirsToSizes;
+    }
+
+  private:
+    std::vector<Directory> directories;
+  };
 
   class Parser
   {
   public:
     Parser() = default;
 
-    DirectoryToSize parseToPathsAndDirSizes(const std::vector<Token> tokens)
+    DirectoryToSize parseToPathsAndDirSizes(const std::vector<Token> &tokens)
+    {
+      return parseToDirectoryTree(tokens).ToDirectoryToSize();
+    }
+
+    DirectoryTree parseToDirectoryTree(const std::vector<Token> &tokens)
     {
       ParseTokens(tokens);
-      AddInnerDirSizesToOuterDirs();
-      return dirsToSizes;
+      tree.AccumulateSizes();
+      return tree;
     }
 
   private:
-    void ParseTokens(const std::vector<Token> tokens)
+    void ParseTokens(const std::vector<Token> &tokens)
     {
       for (const auto &token : tokens)
       {
@@ -87,57 +173,25 @@ namespace
     {
       if (token.value == changeDirToPrevious)
       {
-        ChangeCurrentDirectoryToPrevious();
+        currentDirectory = tree.GetParent(currentDirectory);
       }
-      else
-      {
-        AddDirectoryToCurrentPath(token.value);
-        dirsToSizes.insert({currentPath, {}});
-      }
-    }
-
-    void AddDirectoryToCurrentPath(const std::string &directory)
-    {
-      if (!currentPath.empty() and currentPath != dirSeparator)
+      else if (token.value == dirSeparator)
       {
-        currentPath += dirSeparator + directory;
+        currentDirectory = DirectoryTree::root;
       }
       else
       {
-        currentPath += directory;
-      }
-    }
-
-    void ChangeCurrentDirectoryToPrevious()
-    {
-      currentPath = currentPath.substr(0, currentPath.rfind(dirSeparator));
-      if (currentPath.empty())
-      {
-        currentPath = "/";
+        currentDirectory = tree.GetOrAddChild(currentDirectory, token.value);
       }
     }
 
     void ParseFileToken(const Token &token)
     {
-      dirsToSizes.at(currentPath) += std::stoi(token.value);
+      tree.AddFile(currentDirectory, std::stoll(token.value));
     }
 
-    void AddInnerDirSizesToOuterDirs()
-    {
-      for (auto &[outerPath, outerDirSize] : dirsToSizes)
-      {
-        for (const auto &[innerPath, innerDirSize] : dirsToSizes)
-        {
-          if ( innerPath.find(outerPath) == 0 and outerPath != innerPath)
-          {
-            outerDirSize += innerDirSize;
-          }
-        }
-      }
-    }
-
-    std::string currentPath{};
-    DirectoryToSize dirsToSizes;
+    std::size_t currentDirectory = DirectoryTree::root;
+    DirectoryTree tree;
 
     const std::string dirSeparator{"/"};
     const std::string changeDirToPrevious{".."};
@@ -211,7 +265,9 @@ TEST_CASE("parse tokens")
   }
 }
 
-DirectoryToSize ParseInstructions(std::basic_istream<char> &instructions)
+namespace
+{
+DirectoryTree ParseInstructions(std::basic_istream<char> &instructions)
 {
   std::string instruction{};
   Lexer lexer;
@@ -223,21 +279,96 @@ DirectoryToSize ParseInstructions(std::basic_istream<char> &instructions)
     tokens.push_back(lexer.lex(instruction));
   }
 
-  return parser.parseToPathsAndDirSizes(tokens);
+  return parser.parseToDirectoryTree(tokens);
 }
 
-int GetSizeOfRequiredSpace(const DirectoryToSize &dirsToSizes)
+long long GetSizeOfRequiredSpace(const DirectoryTree &tree)
 {
-  constexpr int totalSpace = 70000000;
-  constexpr int updateSpace = 30000000;
+  constexpr long long totalSpace = 70000000;
+  constexpr long long updateSpace = 30000000;
 
-  const int usedSpace = dirsToSizes.at("/");
+  const long long usedSpace = tree.GetDirectories()[DirectoryTree::root].totalSize;
 
-  const int unusedSpace = totalSpace - usedSpace;
-  const int spaceToFree = updateSpace - unusedSpace;
+  const long long unusedSpace = totalSpace - usedSpace;
+  const long long spaceToFree = updateSpace - unusedSpace;
   return spaceToFree;
 }
 
+long long SumSizesOfSmallDirectories(const DirectoryTree &tree, long long maxSize = 100000)
+{
+  long long sum = 0;
+  for (const auto &directory : tree.GetDirectories())
+  {
+    sum += directory.totalSize <= maxSize ? directory.totalSize : 0;
+  }
+  return sum;
+}
+
+long long FindSizeOfDirectoryToDelete(const DirectoryTree &tree)
+{
+  const long long requiredSpace = GetSizeOfRequiredSpace(tree);
+  long long smallest = tree.GetDirectories()[DirectoryTree::root].totalSize;
+  for (const auto &directory : tree.GetDirectories())
+  {
+    if (directory.totalSize >= requiredSpace)
+    {
+      smallest = std::min(smallest, directory.totalSize);
+    }
+  }
+  return smallest;
+}
+}
+
+TEST_CASE("directory tree")
+{
+  std::vector<Token> tokens{{Token::ChangeDir, {"/"}}};
+  tokens.push_back({Token::ChangeDir, "a"});
+  tokens.push_back({Token::File, "1"});
+  tokens.push_back({Token::ChangeDir, ".."});
+  tokens.push_back({Token::ChangeDir, "ab"});
+  tokens.push_back({Token::File, "20"});
+  tokens.push_back({Token::ChangeDir, "a"});
+  tokens.push_back({Token::File, "300"});
+  tokens.push_back({Token::ChangeDir, "/"});
+  tokens.push_back({Token::ChangeDir, "a"});
+  tokens.push_back({Token::File, "4000"});
+
+  SECTION("sibling with common prefix is not nested")
+  {
+    DirectoryToSize ExpectedDirToSize{
+        {"/", 4321},
+        {"/a", 4001},
+        {"/ab", 320},
+        {"/ab/a", 300}};
+
+    CHECK(Parser{}.parseToPathsAndDirSizes(tokens) == ExpectedDirToSize);
+  }
+
+  SECTION("tree nodes")
+  {
+    const auto tree = Parser{}.parseToDirectoryTree(tokens);
+    const auto &directories = tree.GetDirectories();
+
+    REQUIRE(4 == directories.size());
+    CHECK(2 == directories[DirectoryTree::root].children.size());
+    CHECK(4321 == directories[DirectoryTree::root].totalSize);
+    CHECK(0 == directories[DirectoryTree::root].filesSize);
+    CHECK("ab" == directories[directories[3].parent].name);
+  }
+
+  SECTION("deep tree")
+  {
+    std::vector<Token> deepTokens{{Token::ChangeDir, {"/"}}};
+    for (int depth = 0; depth < 100000; ++depth)
+    {
+      deepTokens.push_back({Token::ChangeDir, "d"});
+      deepTokens.push_back({Token::File, "1"});
+    }
+    const auto tree = Parser{}.parseToDirectoryTree(deepTokens);
+    CHECK(100000 == tree.GetDirectories()[DirectoryTree::root].totalSize);
+  }
+}
+
 TEST_CASE("lexer and parser integration")
 {
   std::stringstream test{};
@@ -265,7 +396,8 @@ TEST_CASE("lexer and parser integration")
        << "5626152 d.ext\n"
        << "7214296 k\n";
 
-  const auto &dirsToSizes = ParseInstructions(test);
+  const auto tree = ParseInstructions(test);
+  const auto dirsToSizes = tree.ToDirectoryToSize();
 
   CHECK(dirsToSizes.at("/a") == 94853);
   CHECK(dirsToSizes.at("/a/e") == 584);
@@ -273,7 +405,9 @@ TEST_CASE("lexer and parser integration")
   CHECK(2 == std::count_if(dirsToSizes.begin(), dirsToSizes.end(), [&](const auto &dirAndSize)
                            { return dirAndSize.second <= 100000; }));
 
-  CHECK(GetSizeOfRequiredSpace(dirsToSizes) == 8381165);
+  CHECK(GetSizeOfRequiredSpace(tree) == 8381165);
+  CHECK(SumSizesOfSmallDirectories(tree) == 95437);
+  CHECK(FindSizeOfDirectoryToDelete(tree) == 24933642);
 }
 
 TEST_CASE("read day 7 data")
@@ -281,29 +415,15 @@ TEST_CASE("read day 7 data")
   std::fstream my_file;
   my_file.open("day7_data.txt", std::ios::in);
 
-  const auto &dirsToSizes = ParseInstructions(my_file);
+  const auto tree = ParseInstructions(my_file);
 
   SECTION("task 1")
   {
-    int sum = std::accumulate(dirsToSizes.begin(), dirsToSizes.end(), 0, [&](auto sum, const auto &dirAndSize)
-                              { return sum += dirAndSize.second <= 100000 ? dirAndSize.second : 0; });
-
-    std::cout << "Day 7 task 1 result: " << sum << std::endl;
+    std::cout << "Day 7 task 1 result: " << SumSizesOfSmallDirectories(tree) << std::endl;
   }
 
   SECTION("task 2")
   {
-    const int requiredSpace = GetSizeOfRequiredSpace(dirsToSizes);
-    std::vector<int> bigDirectoriesSizes;
-    for (const auto &[key, value] : dirsToSizes)
-    {
-      if (value >= requiredSpace)
-      {
-        bigDirectoriesSizes.push_back(value);
-      }
-    }
-    const auto &smallestPossibleDirSize = std::min_element(bigDirectoriesSizes.begin(), bigDirectoriesSizes.end());
-
-    std::cout << "Day 7 task 2 result: " << *smallestPossibleDirSize << std::endl;
+    std::cout << "Day 7 task 2 result: " << FindSizeOfDirectoryToDelete(tree) << std::endl;
   }
 }